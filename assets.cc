@@ -0,0 +1,53 @@
+#include "assets.h"
+
+namespace {
+  constexpr int kTileSize = 16;
+
+  struct SheetFile {
+    const char* file;
+    int columns;
+  };
+
+  // In the same order as Sheet.
+  constexpr SheetFile kSheets[] = {
+    { "enemies.png", 8 },
+    { "player.png", 4 },
+    { "weapons.png", 2 },
+    { "ui.png", 3 },
+    { "tiles.png", 4 },
+  };
+
+  constexpr const char* kTextFile = "text.png";
+  constexpr size_t kFiles = sizeof(kSheets) / sizeof(kSheets[0]) + 1;
+}
+
+Assets::Assets() : sheets_(), text_(kTextFile), preloaded_(0) {
+  for (const auto& sheet : kSheets) {
+    sheets_.emplace_back(sheet.file, sheet.columns, kTileSize, kTileSize);
+  }
+}
+
+Assets& Assets::instance() {
+  static Assets assets;
+  return assets;
+}
+
+const SpriteMap& Assets::sprites(Sheet sheet) {
+  return instance().sheets_[static_cast<size_t>(sheet)];
+}
+
+const Text& Assets::text() {
+  return instance().text_;
+}
+
+// gam decodes an image the first time something is drawn from it, so asking
+// for it here moves that work off the first frame that needs it.
+bool Assets::preload(Graphics& graphics) {
+  size_t& next = instance().preloaded_;
+  if (next >= kFiles) return false;
+
+  graphics.load_image(next < kFiles - 1 ? kSheets[next].file : kTextFile);
+  ++next;
+
+  return next < kFiles;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "graphics.h"
+#include "spritemap.h"
+#include "text.h"
+
+// Every sprite sheet and font in the game, set up once for the whole process
+// and handed out by reference.
+class Assets {
+  public:
+
+    enum class Sheet { Enemies, Player, Weapons, Ui, Tiles };
+
+    static const SpriteMap& sprites(Sheet sheet);
+    static const Text& text();
+
+    // Loads one more image into the graphics cache, a frame at a time,
+    // returning false once there are none left.
+    static bool preload(Graphics& graphics);
+
+  private:
+
+    std::vector<SpriteMap> sheets_;
+    Text text_;
+    size_t preloaded_;
+
+    Assets();
+
+    static Assets& instance();
+};
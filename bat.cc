@@ -1,62 +1,153 @@
 #include "bat.h"
 
-#include <cmath>
-#include <random>
+#include <algorithm>
 
-Bat::Bat(double x, double y) :
-  Entity("enemies.png", 8, x, y, 4),
+#include "assets.h"
+
+Bat::Bat(Fixed x, Fixed y) :
+  Entity(Assets::sprites(Assets::Sheet::Enemies), x, y, 4),
   cx_(0), cy_(0), clockwise_(true) {}
 
 void Bat::ai(const Dungeon&, const Entity& player) {
   if (state_ == State::Holding) return;
 
-  const double dx = x_ - player.x();
-  const double dy = y_ - player.y();
-  const double rad = std::hypot(dx, dy);
+  const Fixed dx = x_ - player.x();
+  const Fixed dy = y_ - player.y();
 
-  if (rad < kAttackRadius && state_ == State::Waiting) {
+  if (within(dx, dy, kAttackRadius) && state_ == State::Waiting) {
     state_transition(State::Attacking);
 
-    std::uniform_int_distribution<int> r(0, 1);
-    clockwise_ = r(rd_) == 0;
+    clockwise_ = rd_.range(0, 1) == 0;
 
     cx_ = player.x();
     cy_ = player.y();
-  } else if (rad < kFollowRadius && state_ == State::Attacking) {
+  } else if (within(dx, dy, kFollowRadius) && state_ == State::Attacking) {
     cx_ = player.x();
     cy_ = player.y();
   }
 }
 
+void Bat::Flock::clear() {
+  index.clear();
+  x.clear();
+  y.clear();
+  cos.clear();
+  sin.clear();
+}
+
+void Bat::join(Flock& flock, uint32_t index, unsigned int elapsed) const {
+  if (state_ != State::Attacking) return;
+
+  int32_t c, s;
+  turn(elapsed, c, s);
+
+  flock.index.push_back(index);
+  flock.x.push_back((x_ - cx_).raw());
+  flock.y.push_back((y_ - cy_).raw());
+  flock.cos.push_back(c);
+  flock.sin.push_back(clockwise_ ? s : -s);
+}
+
+void Bat::land(const Flock& flock, size_t i) {
+  x_ = cx_ + Fixed::from_raw(flock.x[i]);
+  y_ = cy_ + Fixed::from_raw(flock.y[i]);
+}
+
+// Rotates every offset in place.  There are no branches or calls in here so
+// the compiler is free to do several bats at a time.
+void Bat::fly(Flock& flock) {
+  const size_t n = flock.index.size();
+  int32_t* x = flock.x.data();
+  int32_t* y = flock.y.data();
+  const int32_t* c = flock.cos.data();
+  const int32_t* s = flock.sin.data();
+
+  const int64_t half = kTurnOne / 2;
+  for (size_t i = 0; i < n; ++i) {
+    const int64_t ox = x[i];
+    const int64_t oy = y[i];
+    x[i] = static_cast<int32_t>((ox * c[i] - oy * s[i] + half) >> kTurnShift);
+    y[i] = static_cast<int32_t>((ox * s[i] + oy * c[i] + half) >> kTurnShift);
+  }
+}
+
 void Bat::update(Dungeon& dungeon, unsigned int elapsed) {
   Entity::update(dungeon, elapsed);
 
+  // The flight itself already happened in fly.
   if (state_ == State::Attacking) {
-    double angle = std::atan2(y_ - cy_, x_ - cx_);
-    double radius = std::hypot(y_ - cy_, x_ - cx_);
-    angle += elapsed * kFlyingSpeed * (clockwise_ ? 1 : -1);
-    x_ = std::cos(angle) * radius + cx_;
-    y_ = std::sin(angle) * radius + cy_;
-
     if (timer_ > kFlyTime) state_transition(State::Holding);
   } else if (state_ == State::Holding && timer_ > kRestTime) {
     state_transition(State::Waiting);
   }
 }
 
-void Bat::draw(Graphics& graphics, int xo, int yo) const {
-  Entity::draw(graphics, xo, yo);
+void Bat::draw(DrawList& list, int xo, int yo) const {
+  Entity::draw(list, xo, yo);
 #ifndef NDEBUG
   if (cx_ != 0 || cy_ != 0) {
-    graphics.draw_line(x_ - xo, y_ - yo, cx_ - xo, cy_ - yo, 0x0000ffff);
+    list.line(DrawList::Layer::Front, x_.to_int() - xo, y_.to_int() - yo, cx_.to_int() - xo, cy_.to_int() - yo, 0x0000ffff);
   }
 #endif
 }
 
+int Bat::sleep_time(const Entity& player) const {
+  if (!settled()) return 0;
+
+  if (state_ == State::Waiting) {
+    return time_to_reach(player, kAttackRadius);
+  } else if (state_ == State::Holding) {
+    return std::min(kRestTime + 1 - timer_, time_to_reach(player, kContactRange));
+  }
+
+  return 0;
+}
+
+bool Bat::within(Fixed dx, Fixed dy, int radius) {
+  const int64_t x = dx.raw();
+  const int64_t y = dy.raw();
+  const int64_t r = (int64_t)radius * Fixed::kOne;
+  return x * x + y * y < r * r;
+}
+
+// Cosine and sine of the angle flown in the given time, from their Taylor
+// series so the result is exact integer math on every platform.  Long times
+// are done in steps small enough for the series to stay accurate.
+void Bat::turn(unsigned int elapsed, int32_t& cos, int32_t& sin) {
+  int64_t c = kTurnOne, s = 0;
+
+  while (elapsed > 0) {
+    const unsigned int step = std::min(elapsed, kMaxTurnTime);
+    elapsed -= step;
+
+    const int64_t a = kTurnPerMs * step;
+    const int64_t a2 = (a * a) >> kTurnShift;
+
+    int64_t sc = kTurnOne, ss = kTurnOne;
+    for (int k = 8; k > 0; k -= 2) {
+      sc = kTurnOne - ((a2 * sc >> kTurnShift) / ((k - 1) * k));
+      ss = kTurnOne - ((a2 * ss >> kTurnShift) / (k * (k + 1)));
+    }
+    ss = (a * ss) >> kTurnShift;
+
+    const int64_t nc = (c * sc - s * ss) >> kTurnShift;
+    const int64_t ns = (c * ss + s * sc) >> kTurnShift;
+    c = nc;
+    s = ns;
+  }
+
+  cos = static_cast<int32_t>(c);
+  sin = static_cast<int32_t>(s);
+}
+
 int Bat::sprite_number() const {
   return state_ == State::Attacking ? 4 + (timer_ / 100) % 2 : 6;
 }
 
-bool Bat::collision(const Dungeon&) const {
+bool Bat::tile_collision() const {
   return false;
 }
+
+constexpr int64_t Bat::kTurnOne;
+constexpr int64_t Bat::kTurnPerMs;
+constexpr unsigned int Bat::kMaxTurnTime;
@@ -1,28 +1,54 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "entity.h"
 
-class Bat : public Entity {
+class Bat final : public Entity {
   public:
 
-    Bat(double x, double y);
+    // Offsets from the orbit centre of every attacking bat and how far each
+    // one turns this tick, packed so that a whole swarm turns in one loop.
+    struct Flock {
+      std::vector<uint32_t> index;
+      std::vector<int32_t> x, y, cos, sin;
+
+      void clear();
+    };
+
+    Bat(Fixed x, Fixed y);
+
+    void join(Flock& flock, uint32_t index, unsigned int elapsed) const;
+    void land(const Flock& flock, size_t i);
+    static void fly(Flock& flock);
 
     void ai(const Dungeon& dungeon, const Entity& player) override;
     void update(Dungeon& dungeon, unsigned int elapsed) override;
-    void draw(Graphics& graphics, int xo, int yo) const;
+    void draw(DrawList& list, int xo, int yo) const;
+    int sleep_time(const Entity& player) const override;
 
   private:
 
     static constexpr double kFlyingSpeed = 0.002;
-    static constexpr double kAttackRadius = 50;
-    static constexpr double kFollowRadius = kAttackRadius * 1.5;
+
+    // Angles, sines and cosines have 30 bits of fraction.
+    static constexpr int kTurnShift = 30;
+    static constexpr int64_t kTurnOne = int64_t(1) << kTurnShift;
+    static constexpr int64_t kTurnPerMs = static_cast<int64_t>(kFlyingSpeed * kTurnOne + 0.5);
+    static constexpr unsigned int kMaxTurnTime = 250;
+    static constexpr int kAttackRadius = 50;
+    static constexpr int kFollowRadius = kAttackRadius * 3 / 2;
     static constexpr int kRestTime = 1500;
     static constexpr int kFlyTime = kRestTime * 3;
 
-    double cx_, cy_;
+    Fixed cx_, cy_;
     bool clockwise_;
 
+    static bool within(Fixed dx, Fixed dy, int radius);
+    static void turn(unsigned int elapsed, int32_t& cos, int32_t& sin);
+
     int sprite_number() const override;
-    bool collision(const Dungeon&) const override;
+    bool tile_collision() const override;
 };
 
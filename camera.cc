@@ -2,24 +2,20 @@
 
 #include "config.h"
 
-double clamp(double v, double lo, double hi) {
-  return v < lo ? lo : hi < v ? hi : v;
-}
-
 Camera::Camera() : ox_(0), oy_(0) {}
 
 void Camera::update(const Player& player) {
-  const double px = player.x();
-  const double py = player.y();
+  const int px = player.x().to_int();
+  const int py = player.y().to_int();
 
   ox_ = px - kConfig.graphics.width / 2;
   oy_ = py - kConfig.graphics.height / 2;
 }
 
 int Camera::xoffset() const {
-  return (int)ox_;
+  return ox_;
 }
 
 int Camera::yoffset() const {
-  return (int)oy_;
+  return oy_;
 }
@@ -12,5 +12,5 @@ class Camera {
 
   private:
 
-    double ox_, oy_;
+    int ox_, oy_;
 };
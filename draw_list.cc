@@ -0,0 +1,111 @@
+#include "draw_list.h"
+
+#include <algorithm>
+
+DrawList::DrawList() : width_(0), height_(0) {}
+
+void DrawList::begin(int width, int height) {
+  width_ = width;
+  height_ = height;
+  commands_.clear();
+  strings_.clear();
+  groups_.clear();
+}
+
+int DrawList::width() const {
+  return width_;
+}
+
+int DrawList::height() const {
+  return height_;
+}
+
+void DrawList::sprite(Layer layer, const SpriteMap& sheet, int n, int x, int y, bool hflip) {
+  add({ Kind::Sprite, layer, hflip, 0, &sheet, n, x, y, 0, 0 });
+}
+
+void DrawList::text(Layer layer, const Text& font, const std::string& text, int x, int y, Text::Alignment alignment) {
+  strings_.push_back(text);
+  add({ Kind::Text, layer, false, 0, &font, static_cast<int>(strings_.size() - 1), x, y, static_cast<int>(alignment), 0 });
+}
+
+void DrawList::rect(Layer layer, int x, int y, int w, int h, int color, bool filled) {
+  add({ Kind::Rect, layer, filled, 0, nullptr, color, x, y, w, h });
+}
+
+void DrawList::line(Layer layer, int x1, int y1, int x2, int y2, int color) {
+  add({ Kind::Line, layer, false, 0, nullptr, color, x1, y1, x2, y2 });
+}
+
+void DrawList::append(const DrawList& other) {
+  for (Command c : other.commands_) {
+    if (c.kind == Kind::Text) {
+      strings_.push_back(other.strings_[c.n]);
+      c.n = strings_.size() - 1;
+    }
+    add(c);
+  }
+}
+
+void DrawList::sort() {
+  std::stable_sort(commands_.begin(), commands_.end(),
+      [](const Command& a, const Command& b) {
+        if (a.layer != b.layer) return a.layer < b.layer;
+        return a.group < b.group;
+      });
+}
+
+void DrawList::draw(Graphics& graphics) const {
+  for (const auto& c : commands_) {
+    switch (c.kind) {
+      case Kind::Sprite:
+        if (c.flag) {
+          static_cast<const SpriteMap*>(c.source)->draw_ex(graphics, c.n, c.x, c.y, true, 0, 0, 0);
+        } else {
+          static_cast<const SpriteMap*>(c.source)->draw(graphics, c.n, c.x, c.y);
+        }
+        break;
+
+      case Kind::Text:
+        static_cast<const Text*>(c.source)->draw(graphics, strings_[c.n], c.x, c.y,
+            static_cast<Text::Alignment>(c.w));
+        break;
+
+      case Kind::Rect:
+        {
+          const SDL_Rect r = { c.x, c.y, c.w, c.h };
+          graphics.draw_rect(&r, c.n, c.flag);
+        }
+        break;
+
+      case Kind::Line:
+        graphics.draw_line(c.x, c.y, c.w, c.h, c.n);
+        break;
+    }
+  }
+}
+
+size_t DrawList::size() const {
+  return commands_.size();
+}
+
+size_t DrawList::groups() const {
+  return groups_.size();
+}
+
+// Most commands come in runs from the same sheet, so the last group is
+// checked before looking through the rest.
+void DrawList::add(const Command& command) {
+  uint32_t group = groups_.size();
+  for (uint32_t i = groups_.size(); i > 0; --i) {
+    const Group& g = groups_[i - 1];
+    if (g.layer == command.layer && g.source == command.source) {
+      group = i - 1;
+      break;
+    }
+  }
+  if (group == groups_.size()) groups_.push_back({ command.layer, command.source });
+
+  commands_.push_back(command);
+  commands_.back().group = group;
+}
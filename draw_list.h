@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "graphics.h"
+#include "spritemap.h"
+#include "text.h"
+
+// Everything to be drawn for a frame, collected first and then sent to the
+// renderer grouped by layer and by sheet.  Draws from one sheet that follow
+// each other get batched together by the renderer, so grouping them is what
+// keeps the number of render calls down.
+class DrawList {
+  public:
+
+    enum class Layer : uint8_t { Floor, Entities, Behind, Player, Front, Effects, Screen, Hud };
+
+    DrawList();
+
+    // Empties the list to start a new frame of the given size.
+    void begin(int width, int height);
+
+    int width() const;
+    int height() const;
+
+    void sprite(Layer layer, const SpriteMap& sheet, int n, int x, int y, bool hflip = false);
+    void text(Layer layer, const Text& font, const std::string& text, int x, int y,
+        Text::Alignment alignment = Text::Alignment::Left);
+    void rect(Layer layer, int x, int y, int w, int h, int color, bool filled);
+    void line(Layer layer, int x1, int y1, int x2, int y2, int color);
+
+    // Everything from another list, as if it had been added here.
+    void append(const DrawList& other);
+
+    // Within a layer, sheets are drawn in the order they were first used and
+    // everything from one sheet keeps the order it was added in.
+    void sort();
+    void draw(Graphics& graphics) const;
+
+    size_t size() const;
+    size_t groups() const;
+
+  private:
+
+    enum class Kind : uint8_t { Sprite, Text, Rect, Line };
+
+    // Shapes have no source, and share a group per layer.
+    struct Command {
+      Kind kind;
+      Layer layer;
+      bool flag;
+      uint32_t group;
+      const void* source;
+      int n, x, y, w, h;
+    };
+
+    struct Group {
+      Layer layer;
+      const void* source;
+    };
+
+    int width_, height_;
+    std::vector<Command> commands_;
+    std::vector<std::string> strings_;
+    std::vector<Group> groups_;
+
+    void add(const Command& command);
+};
@@ -1,22 +1,33 @@
 #include "dungeon.h"
 
 #include <algorithm>
+#include <map>
+#include <set>
 #include <stack>
-#include <unordered_set>
 
-#include "util.h"
-
-#include "bat.h"
-#include "entity.h"
+#include "assets.h"
 #include "log.h"
-#include "powerup.h"
-#include "slime.h"
-#include "spike_trap.h"
+#include "thread_pool.h"
 
 Dungeon::Dungeon(int width, int height, TuningParams params) :
-  width_(width), height_(height), params_(params), rng_(Util::random_seed()),
-  tiles_("tiles.png", 4, kTileSize, kTileSize)
+  width_(width), height_(height), params_(params),
+  seed_(0), spawned_(0), rand_(0, kGenerationStream), rng_(0, kDropStream),
+  walkable_(width * height, false), transparent_(width * height, false),
+  map_colors_(width * height, kUnseenColor),
+  zone_cols_((width + kZoneSize - 1) / kZoneSize),
+  zone_rows_((height + kZoneSize - 1) / kZoneSize),
+  now_(0), coarse_tick_time_(kCoarseTickTime),
+  field_(width * height, 0), field_stamp_(width * height, 0),
+  field_generation_(0), field_origin_({-1, -1}), field_dirty_(true),
+  pathfinder_(width, height),
+  tiles_(Assets::sprites(Assets::Sheet::Tiles))
 {
+  // Stagger the coarse ticks so far away zones don't all land on one frame.
+  for (int i = 0; i < zone_cols_ * zone_rows_; ++i) {
+    zones_.push_back(Zone{ {}, {}, false, (i * 37u) % kCoarseTickTime });
+  }
+  zone_ticking_.resize(zones_.size(), false);
+
   for (int y = 0; y < height_; ++y) {
     for (int x = 0; x < width_; ++x) {
       cells_[y][x] = { Dungeon::Tile::Wall, 0, false, false };
@@ -24,9 +35,12 @@ Dungeon::Dungeon(int width, int height, TuningParams params) :
   }
 }
 
-void Dungeon::generate(unsigned int seed) {
+void Dungeon::generate(uint64_t seed) {
   DEBUG_LOG << "Generating dungeon with seed " << seed << "\n";
-  rand_.seed(seed);
+  seed_ = seed;
+  rand_ = Random(seed, kGenerationStream);
+  rng_ = Random(seed, kDropStream);
+  particles_.seed(seed, kEffectStream);
 
   // place rooms
   const int min_room_count = (int)(params_.room_density * width_ * height_ / 2);
@@ -43,7 +57,6 @@ void Dungeon::generate(unsigned int seed) {
 
   // generate hallways
   std::stack<Position> stack;
-  std::uniform_real_distribution<double> r(0, 1);
   Direction last_dir = Direction::North;
   Position pos = find_open_space();
   ++region;
@@ -53,30 +66,26 @@ void Dungeon::generate(unsigned int seed) {
     set_region(pos.x, pos.y, region);
     // TODO place enemies in hallways occasionally
 
-    std::unordered_set<Direction, Util::CastHash<Direction>> dirs;
+    // Kept in a fixed order so the same seed always picks the same way.
+    Direction dirs[4];
+    int count = 0;
     if (get_cell(pos.x, pos.y - 2).tile == Tile::Wall)
-      dirs.insert(Direction::North);
+      dirs[count++] = Direction::North;
     if (get_cell(pos.x, pos.y + 2).tile == Tile::Wall)
-      dirs.insert(Direction::South);
+      dirs[count++] = Direction::South;
     if (get_cell(pos.x - 2, pos.y).tile == Tile::Wall)
-      dirs.insert(Direction::East);
+      dirs[count++] = Direction::East;
     if (get_cell(pos.x + 2, pos.y).tile == Tile::Wall)
-      dirs.insert(Direction::West);
+      dirs[count++] = Direction::West;
 
-    if (dirs.size() > 1) stack.push(pos);
+    if (count > 1) stack.push(pos);
 
-    if (dirs.size() > 0) {
+    if (count > 0) {
       Direction dir;
-      if (dirs.count(last_dir) == 1 && r(rand_) < params_.straightness) {
+      if (std::find(dirs, dirs + count, last_dir) != dirs + count && rand_.real() < params_.straightness) {
         dir = last_dir;
       } else {
-        int n = (int)(r(rand_) * dirs.size());
-        auto it = dirs.begin();
-        while (n > 0) {
-          std::advance(it, 1);
-          --n;
-        }
-        dir = *(it);
+        dir = dirs[(int)(rand_.real() * count)];
       }
 
       last_dir = dir;
@@ -132,7 +141,7 @@ void Dungeon::generate(unsigned int seed) {
       }
 
       placed = true;
-      const int j = (int)(r(rand_) * connectors.size());
+      const int j = (int)(rand_.real() * connectors.size());
       const Connector door = connectors[j];
 
       replace_region(door.region, i);
@@ -143,7 +152,7 @@ void Dungeon::generate(unsigned int seed) {
       for (const auto& c : connectors) {
         if (c.region != door.region) continue;
         if (adjacent_count(c.x, c.y, Tile::DoorClosed) > 0) continue;
-        if (r(rand_) >= params_.extra_doors) continue;
+        if (rand_.real() >= params_.extra_doors) continue;
 
         set_tile(c.x, c.y, Tile::DoorClosed);
       }
@@ -157,7 +166,7 @@ void Dungeon::generate(unsigned int seed) {
     if (connectors.empty()) break;
 
     std::map<int, std::vector<Connector>> doors;
-    std::unordered_set<int> regions_found;
+    std::set<int> regions_found;
     for (const auto& c : connectors) {
       doors[c.region].push_back(c);
       regions_found.insert(c.region);
@@ -172,7 +181,7 @@ void Dungeon::generate(unsigned int seed) {
 
     for (int i : regions_found) {
       DEBUG_LOG << i << " ";
-      const auto door = doors[i][(int)(r(rand_) * doors[i].size())];
+      const auto door = doors[i][(int)(rand_.real() * doors[i].size())];
       set_tile(door.x, door.y, Tile::DoorLocked);
       place_key();
     }
@@ -197,10 +206,16 @@ void Dungeon::generate(unsigned int seed) {
       }
     }
   }
+
+  spike_traps_.each([this](SpikeTrap& t){ t.measure_reach(*this); });
+}
+
+Dungeon::Position Dungeon::grid_coords(int px, int py) const {
+  return { px >> kTileShift, py >> kTileShift };
 }
 
-Dungeon::Position Dungeon::grid_coords(double px, double py) const {
-  return { (int)(px / kTileSize), (int)(py / kTileSize) };
+Dungeon::Position Dungeon::grid_coords(Fixed px, Fixed py) const {
+  return grid_coords(px.to_int(), py.to_int());
 }
 
 void Dungeon::reveal() {
@@ -306,82 +321,544 @@ Dungeon::Position Dungeon::find_tile(Tile tile) const {
 }
 
 bool Dungeon::any_entity_at(int x, int y) const {
-  return any_entity_at(x, y, [](const std::unique_ptr<Entity>& e){ return true; });
+  return any_at(bats_, x, y, nullptr) || any_at(slimes_, x, y, nullptr) ||
+    any_at(spike_traps_, x, y, nullptr) || any_at(powerups_, x, y, nullptr);
 }
 
-bool Dungeon::any_entity_at(int x, int y, std::function<bool(const std::unique_ptr<Entity>&)> pred) const {
-  return std::any_of(entities_.cbegin(), entities_.cend(),
-      [this, x, y, pred](const std::unique_ptr<Entity>& e) {
-        const auto p = grid_coords(e->x(), e->y());
-        return p.x == x && p.y == y && pred(e);
-      });
+bool Dungeon::spike_trap_at(int x, int y, const Entity* ignore) const {
+  return any_at(spike_traps_, x, y, ignore);
 }
 
 void Dungeon::update(Entity& player, unsigned int elapsed) {
+  now_ += elapsed;
+  sleepers_.advance(now_, [this](const Sleeper& s){ wake(s); });
+  schedule_zones(player, elapsed);
+  update_field(player);
+  projectiles_.update(*this, particles_, elapsed);
+
+  update_entities(spike_traps_, player);
+  update_entities(slimes_, player);
+  update_entities(bats_, player);
+  update_entities(powerups_, player);
+  particles_.update(elapsed);
+
+  apply_commands();
+}
+
+void Dungeon::apply_commands() {
+  for (const auto& edit : tile_edits_) {
+    set_tile(edit.x, edit.y, edit.tile);
+    spike_traps_.each([this, &edit](SpikeTrap& t){ t.tile_changed(*this, edit.x, edit.y); });
+  }
+  tile_edits_.clear();
+
+  for (const auto& death : deaths_) despawn(death);
+  deaths_.clear();
+
+  for (const auto& drop : drops_) {
+    const int p = rng_.range(0, 9);
+
+    if (p < 2) {
+      spawn(powerups_, drop.x, drop.y, Powerup::Type::Heart, 0);
+    } else if (p < 4) {
+      spawn(powerups_, drop.x, drop.y, Powerup::Type::Coin, 0);
+    }
+  }
+  drops_.clear();
+}
+
+int Dungeon::zone_index(Fixed px, Fixed py) const {
+  const auto p = grid_coords(px, py);
+  const int zx = std::min(std::max(p.x / kZoneSize, 0), zone_cols_ - 1);
+  const int zy = std::min(std::max(p.y / kZoneSize, 0), zone_rows_ - 1);
+  return zy * zone_cols_ + zx;
+}
+
+// Decides which zones get simulated this frame.  Each entity gets however
+// much time has passed since it was last updated.
+void Dungeon::schedule_zones(const Entity& player, unsigned int elapsed) {
+  const int pz = zone_index(player.x(), player.y());
+  const int px = pz % zone_cols_;
+  const int py = pz / zone_cols_;
+
+  for (int i = 0; i < (int)zones_.size(); ++i) {
+    Zone& zone = zones_[i];
+    const int dx = std::abs(i % zone_cols_ - px);
+    const int dy = std::abs(i / zone_cols_ - py);
+
+    zone_ticking_[i] = false;
+    if (dx <= kActiveZoneRadius && dy <= kActiveZoneRadius) {
+      zone_ticking_[i] = true;
+      zone.pending = 0;
+    } else if (zone.seen) {
+      zone.pending += elapsed;
+      if (zone.pending >= coarse_tick_time_) {
+        zone_ticking_[i] = true;
+        zone.pending = 0;
+      }
+    }
+  }
+}
+
+// Seen zones away from the player get their batched tick this many times
+// less often than usual.
+void Dungeon::set_coarse_tick_scale(unsigned int scale) {
+  coarse_tick_time_ = kCoarseTickTime * scale;
+}
+
+void Dungeon::wake(const Sleeper& sleeper) {
+  switch (sleeper.kind) {
+    case Kind::Bat: wake_sleeper(bats_, sleeper.member); break;
+    case Kind::Slime: wake_sleeper(slimes_, sleeper.member); break;
+    case Kind::SpikeTrap: wake_sleeper(spike_traps_, sleeper.member); break;
+    case Kind::Powerup: wake_sleeper(powerups_, sleeper.member); break;
+  }
+}
+
+// Wakes anything asleep that a projectile could hit on the way, since
+// sleeping entities are not tested against projectiles.  Entities are
+// zoned by their middle, so zones a tile past the path are looked in too.
+void Dungeon::wake_along(const Rect& path) {
+  const int left = zone_index(path.left - kTileSize, path.top - kTileSize);
+  const int right = zone_index(path.right + kTileSize, path.bottom + kTileSize);
+
+  for (int zy = left / zone_cols_; zy <= right / zone_cols_; ++zy) {
+    for (int zx = left % zone_cols_; zx <= right % zone_cols_; ++zx) {
+      const int zone = zy * zone_cols_ + zx;
+      wake_within(bats_, zone, path);
+      wake_within(slimes_, zone, path);
+    }
+  }
+}
+
+Dungeon::Kind Dungeon::kind(const Pool<Bat>&) {
+  return Kind::Bat;
+}
+
+Dungeon::Kind Dungeon::kind(const Pool<Slime>&) {
+  return Kind::Slime;
+}
+
+Dungeon::Kind Dungeon::kind(const Pool<SpikeTrap>&) {
+  return Kind::SpikeTrap;
+}
+
+Dungeon::Kind Dungeon::kind(const Pool<Powerup>&) {
+  return Kind::Powerup;
+}
+
+// Only enemies stop projectiles.
+bool Dungeon::shootable(Kind kind) {
+  return kind == Kind::Bat || kind == Kind::Slime;
+}
+
+template <typename T>
+std::vector<Dungeon::Member>& Dungeon::members(int zone, const Pool<T>& entities) {
+  return zones_[zone].members[static_cast<int>(kind(entities))];
+}
+
+template <typename T>
+std::vector<Dungeon::Member>& Dungeon::sleeping(int zone, const Pool<T>& entities) {
+  return zones_[zone].sleeping[static_cast<int>(kind(entities))];
+}
+
+template <typename T>
+void Dungeon::wake(Pool<T>& entities, const Member& member) {
+  const T& entity = entities[member.index];
+  members(zone_index(entity.x(), entity.y()), entities).push_back(member);
+}
+
+// Entities woken early are already gone from the zone's sleepers, and so is
+// anything that has since gone back to sleep with a later time or died.
+template <typename T>
+void Dungeon::wake_sleeper(Pool<T>& entities, const Member& member) {
+  const T* entity = entities.get({ member.index, member.generation });
+  if (!entity) return;
+
+  const int zone = zone_index(entity->x(), entity->y());
+  auto& list = sleeping(zone, entities);
+  const auto s = std::find_if(list.begin(), list.end(), [&member](const Member& m){
+      return m.index == member.index && m.generation == member.generation && m.since == member.since;
+    });
+  if (s == list.end()) return;
+
+  list.erase(s);
+  members(zone, entities).push_back(member);
+}
+
+template <typename T>
+void Dungeon::wake_within(Pool<T>& entities, int zone, const Rect& area) {
+  auto& list = sleeping(zone, entities);
+  size_t i = 0;
+  while (i < list.size()) {
+    if (entities[list[i].index].hit_box().intersect(area)) {
+      members(zone, entities).push_back(list[i]);
+      list.erase(list.begin() + i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+void Dungeon::despawn(const Death& death) {
+  switch (death.kind) {
+    case Kind::Bat: despawn(bats_, { death.index, death.generation }); break;
+    case Kind::Slime: despawn(slimes_, { death.index, death.generation }); break;
+    case Kind::SpikeTrap: despawn(spike_traps_, { death.index, death.generation }); break;
+    case Kind::Powerup: despawn(powerups_, { death.index, death.generation }); break;
+  }
+}
+
+template <typename T>
+void Dungeon::despawn(Pool<T>& entities, typename Pool<T>::Handle handle) {
+  const T* entity = entities.get(handle);
+  if (!entity) return;
+
+  const int zone = zone_index(entity->x(), entity->y());
+  if (!remove_member(members(zone, entities), handle.index)) {
+    remove_member(sleeping(zone, entities), handle.index);
+  }
+  entities.release(handle);
+}
+
+// Members are found by the zone the entity is in, so one that isn't there
+// is left alone rather than erasing past the end of the list.
+bool Dungeon::remove_member(std::vector<Member>& list, uint32_t index) {
+  const auto m = std::find_if(list.begin(), list.end(),
+      [index](const Member& member){ return member.index == index; });
+  if (m == list.end()) return false;
+
+  list.erase(m);
+  return true;
+}
+
+template <typename T, typename... Args>
+void Dungeon::spawn(Pool<T>& entities, Args&&... args) {
+  const auto handle = entities.spawn(std::forward<Args>(args)...);
+  entities[handle.index].seed(seed_, kEntityStream + spawned_++);
+  wake(entities, { handle.index, handle.generation, now_ });
+}
+
+template <typename T>
+bool Dungeon::any_at(const Pool<T>& entities, int x, int y, const Entity* ignore) const {
+  return entities.any([this, x, y, ignore](const T& e) {
+        if (&e == ignore || e.dead()) return false;
+        const auto p = grid_coords(e.x(), e.y());
+        return p.x == x && p.y == y;
+      });
+}
+
+// Each entity type lives in its own pool and the types are final, so this
+// loop makes direct calls instead of chasing pointers to vtables.  Dead
+// entities stay where they are until the commands are applied.
+template <typename T>
+void Dungeon::update_entities(Pool<T>& entities, Entity& player) {
   const Rect player_attack = player.attack_box();
   const Rect player_hit = player.hit_box();
 
-  for (auto& entity : entities_) {
-    entity->ai(*this, player);
-    entity->update(*this, elapsed);
+  // Collect everything first so that an entity which walks into another
+  // zone is not updated twice.  Only entities about to move need their
+  // position saved for drawing.
+  ticks_.clear();
+  for (size_t z = 0; z < zones_.size(); ++z) {
+    if (!zone_ticking_[z]) continue;
+    for (auto& m : members(z, entities)) {
+      ticks_.push_back({ m.index, now_ - m.since, static_cast<int>(z) });
+      entities[m.index].save_position(now_);
+      m.since = now_;
+    }
+  }
+
+  // AI only reads the dungeon and the player and only writes to the entity
+  // making the decision, so it can be spread across threads.  Everything
+  // that touches shared state happens below in a fixed order.
+  const Entity& target = player;
+  ThreadPool::shared().parallel_for(ticks_.size(), kAiBatchSize,
+      [this, &entities, &target](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+          entities[ticks_[t].index].ai(*this, target);
+        }
+      });
+
+  move_together(entities);
+
+  for (const auto& tick : ticks_) {
+    const uint32_t i = tick.index;
+    const uint32_t generation = entities.handle(i).generation;
+    T& entity = entities[i];
+    const int from = tick.zone;
+
+    // Anything that slept or sat in a coarse zone catches up in pieces, so
+    // it never sweeps through the world in one long move.
+    unsigned int left = tick.elapsed;
+    do {
+      const unsigned int elapsed = std::min(left, kMaxUpdateTime);
+      entity.update(*this, elapsed);
+      left -= elapsed;
+    } while (left > 0);
 
     if (!player_attack.empty()) {
-      if (entity->hit_box().intersect(player_attack)) {
-        entity->hit(player);
+      if (entity.hit_box().intersect(player_attack)) {
+        const int hp = entity.hp();
+        entity.hit(player);
+        if (entity.hp() < hp) particles_.emit(Particles::Effect::Sparks, entity.x(), entity.y());
+      }
+    }
+
+    // Anything that can't be hurt right now lets projectiles fly past.
+    if (entity.vulnerable() && shootable(kind(entities))) {
+      const int shot = projectiles_.hit(entity.hit_box());
+      if (shot >= 0) {
+        projectiles_.spend(shot);
+        entity.hit(player);
+        particles_.emit(Particles::Effect::Sparks, entity.x(), entity.y());
       }
     }
 
-    if (entity->alive() && entity->collision_box().intersect(player_hit)) {
-      player.hit(*entity);
+    if (entity.alive() && entity.collision_box().intersect(player_hit)) {
+      const int hp = player.hp();
+      player.hit(entity);
+      if (player.hp() < hp) particles_.emit(Particles::Effect::Hurt, player.x(), player.y());
+    }
+
+    const int to = zone_index(entity.x(), entity.y());
+    // Nothing that could be hit by a projectile already flying goes to sleep.
+    const int sleep = entity.dead() ? 0 : entity.sleep_time(player);
+    const bool asleep = sleep >= kMinSleepTime &&
+      !(shootable(kind(entities)) && projectiles_.crosses(entity.hit_box()));
+
+    if (entity.dead()) {
+      deaths_.push_back({ kind(entities), i, generation });
+      const bool pickup = kind(entities) == Kind::Powerup;
+      particles_.emit(pickup ? Particles::Effect::Glint : Particles::Effect::Dust, entity.x(), entity.y());
+    }
+
+    if (asleep || to != from) remove_member(members(from, entities), i);
+
+    if (asleep) {
+      sleepers_.schedule(now_ + sleep, { kind(entities), { i, generation, now_ } });
+      sleeping(to, entities).push_back({ i, generation, now_ });
+    } else if (to != from) {
+      members(to, entities).push_back({ i, generation, now_ });
     }
   }
+}
 
-  entities_.erase(std::remove_if( entities_.begin(), entities_.end(),
-        [](const std::unique_ptr<Entity>& e){return e->dead();}), entities_.end());
+// Movement that is cheaper done for every entity of a kind at once, before
+// they each get their own update.
+template <typename T>
+void Dungeon::move_together(Pool<T>&) {}
+
+void Dungeon::move_together(Pool<Bat>& bats) {
+  flock_.clear();
+  for (const auto& tick : ticks_) bats[tick.index].join(flock_, tick.index, tick.elapsed);
+
+  Bat::fly(flock_);
+
+  for (size_t i = 0; i < flock_.index.size(); ++i) bats[flock_.index[i]].land(flock_, i);
 }
 
-void Dungeon::draw(Graphics& graphics, int hud_height, int xo, int yo) const {
-  for (int y = 0; y < height_; ++y) {
-    const int gy = kTileSize * y - yo;
-    if (gy < hud_height - kTileSize) continue;
-    if (gy > graphics.height()) break;
+template <typename T>
+void Dungeon::draw_entities(const Pool<T>& entities, DrawList& list, int xo, int yo, Fixed behind) const {
+  entities.each([this, &list, xo, yo, behind](const T& entity) {
+      if (box_visible(entity.collision_box())) {
+        // Anything that didn't move on the last step is drawn where it is.
+        const auto lag = entity.saved_at() == now_ ? entity.draw_lag(behind) : std::make_pair(0, 0);
+        entity.draw(list, xo - lag.first, yo - lag.second);
+      }
+    });
+}
 
-    for (int x = 0; x < width_; ++x) {
-      const int gx = kTileSize * x - xo;
-      if (gx < -kTileSize) continue;
-      if (gx > graphics.width()) break;
+void Dungeon::draw(DrawList& list, int hud_height, int xo, int yo, Fixed behind) const {
+  // Only the tiles that are at least partly on screen below the HUD.
+  const int left = std::max(0, xo >> kTileShift);
+  const int right = std::min(width_ - 1, (xo + list.width() - 1) >> kTileShift);
+  const int top = std::max(0, (yo + hud_height) >> kTileShift);
+  const int bottom = std::min(height_ - 1, (yo + list.height() - 1) >> kTileShift);
 
+  for (int y = top; y <= bottom; ++y) {
+    const int gy = kTileSize * y - yo;
+    for (int x = left; x <= right; ++x) {
       if (cells_[y][x].seen) {
-        tiles_.draw(graphics, static_cast<int>(cells_[y][x].tile), gx, gy);
-        if (!cells_[y][x].visible) {
-          SDL_Rect r = { gx, gy, kTileSize, kTileSize };
-          graphics.draw_rect(&r, 0x00000080, true);
-        }
+        list.sprite(DrawList::Layer::Floor, tiles_, static_cast<int>(cells_[y][x].tile), kTileSize * x - xo, gy);
       }
     }
   }
 
-  for (const auto& entity : entities_) {
-    if (box_visible(entity->collision_box())) {
-      entity->draw(graphics, xo, yo);
+  // Fog goes over each run of remembered tiles in a row as one rectangle.
+  for (int y = top; y <= bottom; ++y) {
+    int x = left;
+    while (x <= right) {
+      if (!cells_[y][x].seen || cells_[y][x].visible) {
+        ++x;
+        continue;
+      }
+
+      const int start = x;
+      while (x <= right && cells_[y][x].seen && !cells_[y][x].visible) ++x;
+
+      list.rect(DrawList::Layer::Floor, kTileSize * start - xo, kTileSize * y - yo,
+          kTileSize * (x - start), kTileSize, 0x00000080, true);
     }
   }
+
+  draw_entities(spike_traps_, list, xo, yo, behind);
+  draw_entities(powerups_, list, xo, yo, behind);
+  draw_entities(slimes_, list, xo, yo, behind);
+  draw_entities(bats_, list, xo, yo, behind);
+  projectiles_.draw(list, xo, yo);
+  particles_.draw(list, xo, yo);
+}
+
+template <typename T>
+void Dungeon::draw_map_entities(const Pool<T>& entities, DrawList& list, const Rect& source, int xo, int yo, int scale) const {
+  entities.each([this, &list, &source, xo, yo, scale](const T& entity) {
+      if (entity.dead()) return;
+
+      const auto p = grid_coords(entity.x(), entity.y());
+      if (p.x < source.left || p.x >= source.right) return;
+      if (p.y < source.top || p.y >= source.bottom) return;
+      if (!get_cell(p.x, p.y).visible) return;
+
+      list.rect(DrawList::Layer::Hud, xo + (p.x - source.left) * scale, yo + (p.y - source.top) * scale,
+          scale, scale, kEntityColor, true);
+    });
+}
+
+// The map is drawn a row at a time as runs of cells that share a color, with
+// unseen cells left to the background.  Entities go on top as dots.
+void Dungeon::draw_map(DrawList& list, const Rect& source, const Rect& dest) const {
+  const int scale = std::max(1, dest.width() / source.width());
+
+  dest.draw(list, DrawList::Layer::Hud, kUnseenColor, true, 0, 0);
+  draw_map_cells(list, source, dest.left, dest.top, scale);
+  draw_map_entities(spike_traps_, list, source, dest.left, dest.top, scale);
+  draw_map_entities(powerups_, list, source, dest.left, dest.top, scale);
+  draw_map_entities(slimes_, list, source, dest.left, dest.top, scale);
+  draw_map_entities(bats_, list, source, dest.left, dest.top, scale);
+  dest.draw(list, DrawList::Layer::Hud, 0xffffffff, false, 0, 0);
+}
+
+// The whole floor as large as it fits in dest, centered, with the marker
+// showing where the player is.
+void Dungeon::draw_floor_map(DrawList& list, const Rect& dest, Position marker) const {
+  const int scale = std::max(1, std::min(dest.width() / width_, dest.height() / height_));
+  const int left = dest.left + (dest.width() - width_ * scale) / 2;
+  const int top = dest.top + (dest.height() - height_ * scale) / 2;
+
+  dest.draw(list, DrawList::Layer::Hud, kUnseenColor, true, 0, 0);
+  draw_map(list, { 0, 0, width_, height_ },
+      { left, top, left + width_ * scale, top + height_ * scale });
+
+  list.rect(DrawList::Layer::Hud, left + marker.x * scale, top + marker.y * scale, scale, scale, kMarkerColor, true);
 }
 
-void Dungeon::draw_map(Graphics& graphics, const Rect& source, const Rect& dest) const {
-  for (int y = (int)source.top; y < (int)source.bottom; ++y) {
-    const int py = (int)dest.top + y - (int)source.top;
-    for (int x = (int)source.left; x < (int)source.right; ++x) {
-      const int px = (int)dest.left + x - (int)source.left;
-      graphics.draw_pixel(px, py, get_cell_color(x, y));
+void Dungeon::draw_map_cells(DrawList& list, const Rect& source, int xo, int yo, int scale) const {
+  const int left = std::max(0, source.left);
+  const int right = std::min(width_, source.right);
+  const int top = std::max(0, source.top);
+  const int bottom = std::min(height_, source.bottom);
+
+  for (int y = top; y < bottom; ++y) {
+    const int* row = &map_colors_[y * width_];
+    int x = left;
+    while (x < right) {
+      const int start = x;
+      const int color = row[x];
+      while (x < right && row[x] == color) ++x;
+      if (color == kUnseenColor) continue;
+
+      list.rect(DrawList::Layer::Hud, xo + (start - source.left) * scale, yo + (y - source.top) * scale,
+          (x - start) * scale, scale, color, true);
     }
   }
-
-  dest.draw(graphics, 0xffffffff, false, 0, 0);
 }
 
+
 bool Dungeon::walkable(int x, int y) const {
-  switch (get_cell(x, y).tile) {
+  if (x < 0 || x >= width_) return false;
+  if (y < 0 || y >= height_) return false;
+  return walkable_[y * width_ + x];
+}
+
+bool Dungeon::transparent(int x, int y) const {
+  if (x < 0 || x >= width_) return false;
+  if (y < 0 || y >= height_) return false;
+  return transparent_[y * width_ + x];
+}
+
+int Dungeon::player_distance(int x, int y) const {
+  if (x < 0 || x >= width_) return -1;
+  if (y < 0 || y >= height_) return -1;
+  if (field_stamp_[y * width_ + x] != field_generation_) return -1;
+  return field_[y * width_ + x];
+}
+
+// The neighbouring tile that is one step closer to the player, or {-1, -1}
+// if the player is too far away or out of reach.
+Dungeon::Position Dungeon::next_step(int x, int y) const {
+  const int d = player_distance(x, y);
+  if (d <= 0) return {-1, -1};
+
+  const Position neighbors[] = { {x, y - 1}, {x + 1, y}, {x, y + 1}, {x - 1, y} };
+  for (const auto& n : neighbors) {
+    if (player_distance(n.x, n.y) == d - 1) return n;
+  }
+
+  return {-1, -1};
+}
+
+// Breadth first search out from the player over walkable tiles.  It only
+// needs redoing when the player changes tiles or a tile's walkability does,
+// and every chasing enemy shares the result.
+void Dungeon::update_field(const Entity& player) {
+  const auto p = grid_coords(player.x(), player.y());
+  if (!field_dirty_ && p.x == field_origin_.x && p.y == field_origin_.y) return;
+
+  field_dirty_ = false;
+  field_origin_ = p;
+  ++field_generation_;
+
+  if (!walkable(p.x, p.y)) return;
+
+  field_queue_.clear();
+  field_queue_.push_back(p);
+  field_[p.y * width_ + p.x] = 0;
+  field_stamp_[p.y * width_ + p.x] = field_generation_;
+
+  for (size_t i = 0; i < field_queue_.size(); ++i) {
+    const Position c = field_queue_[i];
+    const int d = field_[c.y * width_ + c.x] + 1;
+    if (d > kFieldRadius) continue;
+
+    const Position neighbors[] = { {c.x, c.y - 1}, {c.x + 1, c.y}, {c.x, c.y + 1}, {c.x - 1, c.y} };
+    for (const auto& n : neighbors) {
+      if (!walkable(n.x, n.y)) continue;
+
+      const int index = n.y * width_ + n.x;
+      if (field_stamp_[index] == field_generation_) continue;
+
+      field_[index] = d;
+      field_stamp_[index] = field_generation_;
+      field_queue_.push_back(n);
+    }
+  }
+}
+
+// Closed doors count as a way through since whoever is travelling can open
+// them, locked ones don't.
+// Locked doors are only gone through when unlock is set, for a traveller
+// with a key to use on them.
+std::vector<Dungeon::Position> Dungeon::find_path(Position from, Position to, bool unlock) {
+  std::vector<Position> path;
+  for (const auto& p : pathfinder_.find_path({ from.x, from.y }, { to.x, to.y }, unlock)) {
+    path.push_back({ p.x, p.y });
+  }
+  return path;
+}
+
+bool Dungeon::tile_walkable(Dungeon::Tile tile) {
+  switch (tile) {
     case Dungeon::Tile::Room:
     case Dungeon::Tile::Hallway:
     case Dungeon::Tile::DoorOpen:
@@ -393,8 +870,8 @@ bool Dungeon::walkable(int x, int y) const {
   }
 }
 
-bool Dungeon::transparent(int x, int y) const {
-  switch (get_cell(x, y).tile) {
+bool Dungeon::tile_transparent(Dungeon::Tile tile) {
+  switch (tile) {
     case Dungeon::Tile::Room:
     case Dungeon::Tile::Hallway:
     case Dungeon::Tile::DoorOpen:
@@ -408,10 +885,32 @@ bool Dungeon::transparent(int x, int y) const {
   }
 }
 
+Pathfinder::Cell Dungeon::tile_travel(Dungeon::Tile tile) {
+  switch (tile) {
+    case Dungeon::Tile::Room:
+    case Dungeon::Tile::Hallway:
+    case Dungeon::Tile::StairsUp:
+    case Dungeon::Tile::StairsDown:
+      return Pathfinder::Cell::Open;
+    case Dungeon::Tile::DoorClosed:
+    case Dungeon::Tile::DoorOpen:
+      return Pathfinder::Cell::Door;
+    case Dungeon::Tile::DoorLocked:
+      return Pathfinder::Cell::Locked;
+    default:
+      return Pathfinder::Cell::Blocked;
+  }
+}
+
 void Dungeon::set_tile(int x, int y, Dungeon::Tile tile) {
   if (x < 0 || x >= width_) return;
   if (y < 0 || y >= height_) return;
   cells_[y][x].tile = tile;
+  if (walkable_[y * width_ + x] != tile_walkable(tile)) field_dirty_ = true;
+  walkable_[y * width_ + x] = tile_walkable(tile);
+  transparent_[y * width_ + x] = tile_transparent(tile);
+  pathfinder_.set(x, y, tile_travel(tile));
+  update_map_color(x, y);
 }
 
 void Dungeon::set_region(int x, int y, int region) {
@@ -424,7 +923,11 @@ void Dungeon::set_visible(int x, int y, bool visible) {
   if (x < 0 || x >= width_) return;
   if (y < 0 || y >= height_) return;
   cells_[y][x].visible = visible;
-  if (visible) cells_[y][x].seen = true;
+  if (visible && !cells_[y][x].seen) {
+    cells_[y][x].seen = true;
+    zones_[(y / kZoneSize) * zone_cols_ + x / kZoneSize].seen = true;
+    update_map_color(x, y);
+  }
 }
 
 const Dungeon::Cell& Dungeon::get_cell(int x, int y) const {
@@ -445,8 +948,7 @@ Dungeon::Position Dungeon::find_open_space() const {
 }
 
 int Dungeon::random_odd(int min, int max) {
-  std::uniform_int_distribution<int> r(min / 2, max / 2);
-  return r(rand_) * 2 + 1;
+  return rand_.range(min / 2, max / 2) * 2 + 1;
 }
 
 int Dungeon::place_room(int region) {
@@ -479,15 +981,22 @@ int Dungeon::place_room(int region) {
     }
   }
 
-  std::uniform_int_distribution<int> rx(x + 1, x + w - 1);
-  std::uniform_int_distribution<int> ry(y + 1, y + h - 1);
+  auto rx = [this, x, w]{ return rand_.range(x + 1, x + w - 1); };
+  auto ry = [this, y, h]{ return rand_.range(y + 1, y + h - 1); };
+
+  // x has to be drawn before y, the order arguments are evaluated in is up
+  // to the compiler.
+  auto feature = [this, &rx, &ry](Tile tile) {
+    const int fx = rx();
+    set_tile(fx, ry(), tile);
+  };
 
   if (region == 1) {
-    set_tile(rx(rand_), ry(rand_), Tile::StairsUp);
+    feature(Tile::StairsUp);
   } else if (region == 2) {
-    set_tile(rx(rand_), ry(rand_), Tile::StairsDown);
+    feature(Tile::StairsDown);
   } else if (region <= params_.sections) {
-    set_tile(rx(rand_), ry(rand_), Tile::ChestClosed);
+    feature(Tile::ChestClosed);
     // TODO add items to chests
   } else {
     // TODO implement more room types
@@ -500,41 +1009,38 @@ int Dungeon::place_room(int region) {
     //   Spike traps in room
     //   might depend on the room shape that is decided
 
-    std::uniform_int_distribution<int> rand_percent(0, 99);
-    std::uniform_int_distribution<int> rcount(2, 8);
-
-    if (rand_percent(rand_) < 25) {
+    if (rand_.range(0, 99) < 25) {
       // spike trap room
       const int x1 = x * kTileSize + kHalfTile;
       const int x2 = (x + w) * kTileSize - kHalfTile;
       const int y1 = y * kTileSize + kHalfTile;
       const int y2 = (y + h) * kTileSize - kHalfTile;
 
-      entities_.emplace_back(new SpikeTrap(x1, y1));
-      entities_.emplace_back(new SpikeTrap(x1, y2));
-      entities_.emplace_back(new SpikeTrap(x2, y1));
-      entities_.emplace_back(new SpikeTrap(x2, y2));
+      spawn(spike_traps_, x1, y1);
+      spawn(spike_traps_, x1, y2);
+      spawn(spike_traps_, x2, y1);
+      spawn(spike_traps_, x2, y2);
     }
 
-    if (rand_percent(rand_) < 50) {
+    if (rand_.range(0, 99) < 50) {
       // slime room
 
-      const int slimes = rcount(rand_);
+      const int slimes = rand_.range(2, 8);
       for (int i = 0; i < slimes; ++i) {
-        const int ex = rx(rand_) * kTileSize + kHalfTile;
-        const int ey = ry(rand_) * kTileSize + kHalfTile;
-        entities_.emplace_back(new Slime(ex, ey));
+        const int ex = rx() * kTileSize + kHalfTile;
+        const int ey = ry() * kTileSize + kHalfTile;
+        spawn(slimes_, ex, ey);
       }
     }
 
-    if (rand_percent(rand_) < 50) {
+    if (rand_.range(0, 99) < 50) {
       // bat room
 
-      const int bats = rcount(rand_);
+      const int bats = rand_.range(2, 8);
       for (int i = 0; i < bats; ++i) {
-        const int ex = rx(rand_) * kTileSize + kHalfTile;
-        const int ey = ry(rand_) * kTileSize + kHalfTile;
-        entities_.emplace_back(new Bat(ex, ey));
+        const int ex = rx() * kTileSize + kHalfTile;
+        const int ey = ry() * kTileSize + kHalfTile;
+        spawn(bats_, ex, ey);
       }
     }
   }
@@ -545,7 +1051,7 @@ int Dungeon::place_room(int region) {
 int Dungeon::is_connector(int x, int y, int region) const {
   if (get_cell(x, y).tile != Tile::Wall) return 0;
 
-  std::unordered_set<int> near;
+  std::set<int> near;
   near.insert(get_cell(x - 1, y).region);
   near.insert(get_cell(x + 1, y).region);
   near.insert(get_cell(x, y - 1).region);
@@ -585,11 +1091,10 @@ void Dungeon::place_key() {
     return;
   }
 
-  std::uniform_int_distribution<int> r(0, places.size() - 1);
-  const Position& p = places[r(rand_)];
+  const Position& p = places[rand_.range(0, places.size() - 1)];
   const int kx = p.x * kTileSize + kHalfTile;
   const int ky = p.y * kTileSize + kHalfTile;
-  entities_.emplace_back(new Powerup(kx, ky, Powerup::Type::Key, 0));
+  spawn(powerups_, kx, ky, Powerup::Type::Key, 0);
 }
 
 int Dungeon::adjacent_count(int x, int y, Tile tile) const {
@@ -611,15 +1116,21 @@ bool Dungeon::box_walkable(const Rect& r) const {
   const auto a = grid_coords(r.left, r.top);
   const auto b = grid_coords(r.right, r.bottom);
 
-  return walkable(a.x, a.y) && walkable(a.x, b.y) &&
-         walkable(b.x, a.y) && walkable(b.x, b.y);
+  return area_walkable(a.x, a.y, b.x, b.y);
+}
+
+Dungeon::Position Dungeon::sweep(const Rect& box, int dx, int dy) const {
+  // Resolve each axis separately so sliding along a wall still works.
+  const int mx = sweep_x(box, dx);
+  const Rect moved(box.left + mx, box.top, box.right + mx, box.bottom);
+  return { mx, sweep_y(moved, dy) };
 }
 
 void Dungeon::open_door(int x, int y) {
   switch (get_cell(x, y).tile) {
     case Tile::DoorLocked:
     case Tile::DoorClosed:
-      cells_[y][x].tile = Tile::DoorOpen;
+      tile_edits_.push_back({ x, y, Tile::DoorOpen });
       break;
     default:
       // do nothing
@@ -630,7 +1141,7 @@ void Dungeon::open_door(int x, int y) {
 void Dungeon::close_door(int x, int y) {
   switch (get_cell(x, y).tile) {
     case Tile::DoorOpen:
-      cells_[y][x].tile = Tile::DoorClosed;
+      tile_edits_.push_back({ x, y, Tile::DoorClosed });
       break;
     default:
       // do nothing
@@ -641,7 +1152,7 @@ void Dungeon::close_door(int x, int y) {
 void Dungeon::open_chest(int x, int y) {
   switch (get_cell(x, y).tile) {
     case Tile::ChestClosed:
-      cells_[y][x].tile = Tile::ChestOpen;
+      tile_edits_.push_back({ x, y, Tile::ChestOpen });
       // TODO give treasure to player
       break;
     default:
@@ -650,6 +1161,15 @@ void Dungeon::open_chest(int x, int y) {
   }
 }
 
+bool Dungeon::area_walkable(int x1, int y1, int x2, int y2) const {
+  for (int y = y1; y <= y2; ++y) {
+    for (int x = x1; x <= x2; ++x) {
+      if (!walkable(x, y)) return false;
+    }
+  }
+  return true;
+}
+
 bool Dungeon::box_visible(const Rect& r) const {
   const auto a = grid_coords(r.left, r.top);
   const auto b = grid_coords(r.right, r.bottom);
@@ -660,13 +1180,62 @@ bool Dungeon::box_visible(const Rect& r) const {
          get_cell(b.x, b.y).visible;
 }
 
-int Dungeon::get_cell_color(int x, int y) const {
-  const auto cell = get_cell(x, y);
+int Dungeon::sweep_x(const Rect& r, int dx) const {
+  if (dx == 0) return 0;
+
+  const int top = grid_coords(r.left, r.top).y;
+  const int bottom = grid_coords(r.left, r.bottom).y;
+  const int edge = dx > 0 ? r.right : r.left;
+  const int step = dx > 0 ? 1 : -1;
+  const int from = grid_coords(edge, r.top).x;
+  const int to = grid_coords(edge + dx, r.top).x;
+  const int trailing = grid_coords(dx > 0 ? r.left : r.right, r.top).x;
+
+  // A box partly in a wall can't go any further into it, but one buried in
+  // walls on this axis, say by a door closing on it, can still move out.
+  if (!area_walkable(from, top, from, bottom) && area_walkable(trailing, top, trailing, bottom)) return 0;
+
+  for (int x = from + step; x != to + step; x += step) {
+    if (area_walkable(x, top, x, bottom)) continue;
+
+    if (dx > 0) {
+      return std::max(0, x * kTileSize - 1 - edge);
+    } else {
+      return std::min(0, (x + 1) * kTileSize - edge);
+    }
+  }
+
+  return dx;
+}
+
+int Dungeon::sweep_y(const Rect& r, int dy) const {
+  if (dy == 0) return 0;
+
+  const int left = grid_coords(r.left, r.top).x;
+  const int right = grid_coords(r.right, r.top).x;
+  const int edge = dy > 0 ? r.bottom : r.top;
+  const int step = dy > 0 ? 1 : -1;
+  const int from = grid_coords(r.left, edge).y;
+  const int to = grid_coords(r.left, edge + dy).y;
+  const int trailing = grid_coords(r.left, dy > 0 ? r.top : r.bottom).y;
+
+  if (!area_walkable(left, from, right, from) && area_walkable(left, trailing, right, trailing)) return 0;
+
+  for (int y = from + step; y != to + step; y += step) {
+    if (area_walkable(left, y, right, y)) continue;
+
+    if (dy > 0) {
+      return std::max(0, y * kTileSize - 1 - edge);
+    } else {
+      return std::min(0, (y + 1) * kTileSize - edge);
+    }
+  }
 
-  if (!cell.seen) return 0x000000ff;
-  if (cell.visible && any_entity_at(x, y)) return 0xff0000ff;
+  return dy;
+}
 
-  switch (cell.tile) {
+int Dungeon::tile_color(Tile tile) {
+  switch (tile) {
     case Tile::Wall:
       return 0xaaaaaaff;
     case Tile::DoorClosed:
@@ -682,17 +1251,42 @@ int Dungeon::get_cell_color(int x, int y) const {
   }
 }
 
-void Dungeon::add_drop(double x, double y) {
-  std::uniform_int_distribution<int> r(0, 9);
-  int p = r(rng_);
+void Dungeon::update_map_color(int x, int y) {
+  const Cell& cell = cells_[y][x];
+  map_colors_[y * width_ + x] = cell.seen ? tile_color(cell.tile) : kUnseenColor;
+}
+
+void Dungeon::add_drop(Fixed x, Fixed y) {
+  drops_.push_back({ x, y });
+}
+
+bool Dungeon::launch(Projectiles::Kind kind, Fixed x, Fixed y, Entity::Direction direction) {
+  if (!projectiles_.launch(kind, x, y, direction)) return false;
+  wake_along(Projectiles::reach(kind, x, y, direction));
+  return true;
+}
 
-  if (p < 2) {
-    entities_.emplace_back(new Powerup(x, y, Powerup::Type::Heart, 0));
-  } else if (p < 4) {
-    entities_.emplace_back(new Powerup(x, y, Powerup::Type::Coin, 0));
+// Bats and slimes in turn, each on a random room tile.
+void Dungeon::add_enemies(int count) {
+  for (int i = 0; i < count; ++i) {
+    int x, y;
+    do {
+      x = rand_.range(0, width_ - 1);
+      y = rand_.range(0, height_ - 1);
+    } while (cells_[y][x].tile != Tile::Room);
+
+    if (i % 2 == 0) {
+      spawn(bats_, x * kTileSize + kHalfTile, y * kTileSize + kHalfTile);
+    } else {
+      spawn(slimes_, x * kTileSize + kHalfTile, y * kTileSize + kHalfTile);
+    }
   }
 }
 
+void Dungeon::add_slime(Fixed x, Fixed y) {
+  spawn(slimes_, x, y);
+}
+
 std::vector<Dungeon::Connector> Dungeon::get_connectors(int region, int min) const {
   std::vector<Connector> connectors;
   for (int y = 0; y < height_; ++y) {
@@ -705,3 +1299,5 @@ std::vector<Dungeon::Connector> Dungeon::get_connectors(int region, int min) con
 }
 
 constexpr Dungeon::Cell Dungeon::kBadCell;
+constexpr int Dungeon::kUnseenColor;
+constexpr unsigned int Dungeon::kMaxUpdateTime;
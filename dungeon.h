@@ -1,18 +1,23 @@
 #pragma once
 
-#include <functional>
-#include <memory>
-#include <random>
 #include <vector>
 
 #include "graphics.h"
 #include "spritemap.h"
 
+#include "bat.h"
+#include "draw_list.h"
+#include "fixed.h"
+#include "particles.h"
+#include "pathfinder.h"
+#include "pool.h"
+#include "powerup.h"
+#include "projectiles.h"
+#include "random.h"
 #include "rect.h"
-
-// I have made a huge fucking mess of circular dependencies so I need to
-// forward declare the entity class to get things to build.
-class Entity;
+#include "slime.h"
+#include "spike_trap.h"
+#include "timer_wheel.h"
 
 class Dungeon {
   public:
@@ -44,9 +49,10 @@ class Dungeon {
 
     Dungeon(int width, int height, TuningParams params);
 
-    void generate(unsigned int seed);
+    void generate(uint64_t seed);
 
-    Position grid_coords(double px, double py) const;
+    Position grid_coords(int px, int py) const;
+    Position grid_coords(Fixed px, Fixed py) const;
 
     void reveal();
     void hide();
@@ -55,18 +61,28 @@ class Dungeon {
     const Cell& get_cell(int x, int y) const;
     Position find_tile(Tile tile) const;
     bool any_entity_at(int x, int y) const;
-    bool any_entity_at(int x, int y, std::function<bool(const std::unique_ptr<Entity>&)> pred) const;
+    bool spike_trap_at(int x, int y, const Entity* ignore) const;
 
     void update(Entity& player, unsigned int elapsed);
-    void draw(Graphics& graphics, int hud_height, int xo, int yo) const;
-    void draw_map(Graphics& graphics, const Rect& source, const Rect& dest) const;
+    void set_coarse_tick_scale(unsigned int scale);
+    void draw(DrawList& list, int hud_height, int xo, int yo, Fixed behind) const;
+    void draw_map(DrawList& list, const Rect& source, const Rect& dest) const;
+    void draw_floor_map(DrawList& list, const Rect& dest, Position marker) const;
 
-    void add_drop(double x, double y);
+    void add_drop(Fixed x, Fixed y);
+    bool launch(Projectiles::Kind kind, Fixed x, Fixed y, Entity::Direction direction);
+    void add_enemies(int count);
+    void add_slime(Fixed x, Fixed y);
 
     bool walkable(int x, int y) const;
     bool transparent(int x, int y) const;
 
+    int player_distance(int x, int y) const;
+    Position next_step(int x, int y) const;
+    std::vector<Position> find_path(Position from, Position to, bool unlock);
+
     bool box_walkable(const Rect& r) const;
+    Position sweep(const Rect& box, int dx, int dy) const;
 
     void open_door(int x, int y);
     void close_door(int x, int y);
@@ -75,8 +91,24 @@ class Dungeon {
   private:
     static constexpr int kTileSize = 16;
     static constexpr int kHalfTile = kTileSize / 2;
+    static constexpr int kTileShift = 4;
     static constexpr int kMaxVisibility = 9;
+    static constexpr int kZoneSize = 10;
+    static constexpr int kActiveZoneRadius = 1;
+    static constexpr unsigned int kCoarseTickTime = 250;
+    static constexpr int kMinSleepTime = 64;
+    static constexpr unsigned int kMaxUpdateTime = 50;
+    static constexpr size_t kAiBatchSize = 32;
+    static constexpr int kFieldRadius = 20;
+    static constexpr uint64_t kGenerationStream = 0;
+    static constexpr uint64_t kDropStream = 1;
+    static constexpr uint64_t kEntityStream = 2;
+    // Well clear of the entity streams, which count up from kEntityStream.
+    static constexpr uint64_t kEffectStream = UINT64_MAX;
     static constexpr Cell kBadCell = { Tile::OutOfBounds, 0, false, false };
+    static constexpr int kUnseenColor = 0x000000ff;
+    static constexpr int kEntityColor = 0xff0000ff;
+    static constexpr int kMarkerColor = 0x00ff00ff;
 
     enum class Direction { North, South, East, West };
 
@@ -84,6 +116,56 @@ class Dungeon {
       int x, y, region;
     };
 
+    enum class Kind { Bat, Slime, SpikeTrap, Powerup };
+    static constexpr int kKinds = 4;
+
+    // An entity that is being simulated and the time it was last updated.
+    // Index and generation make up its pool handle, so anything holding on
+    // to a member can tell when the slot has since been reused.
+    struct Member {
+      uint32_t index, generation;
+      unsigned int since;
+    };
+
+    // Entities are bucketed by the zone they are in.  Zones around the player
+    // are simulated every frame, zones that have been seen are simulated in
+    // coarse batches and zones that have never been seen are asleep.
+    // Entities that are idle leave their zone and wait in the timer wheel,
+    // but the zone keeps track of them in case they need waking early.
+    struct Zone {
+      std::vector<Member> members[kKinds];
+      std::vector<Member> sleeping[kKinds];
+      bool seen;
+      unsigned int pending;
+    };
+
+    struct Sleeper {
+      Kind kind;
+      Member member;
+    };
+
+    struct Tick {
+      uint32_t index;
+      unsigned int elapsed;
+      int zone;
+    };
+
+    // Changes collected while a tick runs and applied together at the end of
+    // it, so the simulation never sees the world change under it.
+    struct Drop {
+      Fixed x, y;
+    };
+
+    struct Death {
+      Kind kind;
+      uint32_t index, generation;
+    };
+
+    struct TileEdit {
+      int x, y;
+      Tile tile;
+    };
+
     struct Shadow {
       double start, end;
       bool contains(const Shadow& other) const;
@@ -101,11 +183,50 @@ class Dungeon {
 
     int width_, height_;
     TuningParams params_;
-    std::default_random_engine rand_, rng_;
+    // Generation, drops and every spawned entity each get their own stream.
+    uint64_t seed_, spawned_;
+    Random rand_, rng_;
     Cell cells_[1024][1024];
-    std::vector<std::unique_ptr<Entity>> entities_;
-
-    SpriteMap tiles_;
+    std::vector<bool> walkable_, transparent_;
+    // What each cell looks like on the map, kept up to date as tiles change
+    // or get seen so drawing the map doesn't have to work it out.
+    std::vector<int> map_colors_;
+    Pool<Bat> bats_;
+    Pool<Slime> slimes_;
+    Pool<SpikeTrap> spike_traps_;
+    Pool<Powerup> powerups_;
+    Bat::Flock flock_;
+    Particles particles_;
+    Projectiles projectiles_;
+
+    int zone_cols_, zone_rows_;
+    std::vector<Zone> zones_;
+    std::vector<bool> zone_ticking_;
+    std::vector<Tick> ticks_;
+    TimerWheel<Sleeper> sleepers_;
+    unsigned int now_, coarse_tick_time_;
+
+    // Walking distance from the player's tile, only valid for cells stamped
+    // with the current generation.
+    std::vector<uint16_t> field_;
+    std::vector<unsigned int> field_stamp_;
+    std::vector<Position> field_queue_;
+    unsigned int field_generation_;
+    Position field_origin_;
+    bool field_dirty_;
+
+    Pathfinder pathfinder_;
+
+    std::vector<Drop> drops_;
+    std::vector<Death> deaths_;
+    std::vector<TileEdit> tile_edits_;
+
+    const SpriteMap& tiles_;
+
+    static bool tile_walkable(Tile tile);
+    static bool tile_transparent(Tile tile);
+    static Pathfinder::Cell tile_travel(Tile tile);
+    static int tile_color(Tile tile);
 
     void set_tile(int x, int y, Tile tile);
     void set_region(int x, int y, int region);
@@ -122,8 +243,43 @@ class Dungeon {
     int adjacent_count(int x, int y, Tile tile) const;
     bool is_dead_end(int x, int y) const;
 
+    bool area_walkable(int x1, int y1, int x2, int y2) const;
     bool box_visible(const Rect& r) const;
 
-    int get_cell_color(int x, int y) const;
+    int zone_index(Fixed px, Fixed py) const;
+    void schedule_zones(const Entity& player, unsigned int elapsed);
+
+    void wake(const Sleeper& sleeper);
+    void despawn(const Death& death);
+    void apply_commands();
+    void update_field(const Entity& player);
+
+    static Kind kind(const Pool<Bat>&);
+    static Kind kind(const Pool<Slime>&);
+    static Kind kind(const Pool<SpikeTrap>&);
+    static Kind kind(const Pool<Powerup>&);
+    static bool shootable(Kind kind);
+
+    template <typename T> std::vector<Member>& members(int zone, const Pool<T>& entities);
+    template <typename T> std::vector<Member>& sleeping(int zone, const Pool<T>& entities);
+    template <typename T> void wake(Pool<T>& entities, const Member& member);
+    template <typename T> void wake_sleeper(Pool<T>& entities, const Member& member);
+    template <typename T> void wake_within(Pool<T>& entities, int zone, const Rect& area);
+    void wake_along(const Rect& path);
+    template <typename T> void despawn(Pool<T>& entities, typename Pool<T>::Handle handle);
+    static bool remove_member(std::vector<Member>& list, uint32_t index);
+
+    template <typename T, typename... Args> void spawn(Pool<T>& entities, Args&&... args);
+    template <typename T> bool any_at(const Pool<T>& entities, int x, int y, const Entity* ignore) const;
+    template <typename T> void update_entities(Pool<T>& entities, Entity& player);
+    template <typename T> void move_together(Pool<T>& entities);
+    void move_together(Pool<Bat>& bats);
+    template <typename T> void draw_entities(const Pool<T>& entities, DrawList& list, int xo, int yo, Fixed behind) const;
+    template <typename T> void draw_map_entities(const Pool<T>& entities, DrawList& list, const Rect& source, int xo, int yo, int scale) const;
+    void draw_map_cells(DrawList& list, const Rect& source, int xo, int yo, int scale) const;
+    int sweep_x(const Rect& r, int dx) const;
+    int sweep_y(const Rect& r, int dy) const;
+
+    void update_map_color(int x, int y);
     std::vector<Connector> get_connectors(int region, int min) const;
 };
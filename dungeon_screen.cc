@@ -1,24 +1,128 @@
 #include "dungeon_screen.h"
 
+#include <algorithm>
+#include <cstdlib>
+
+#include "config.h"
 #include "title_screen.h"
 
 DungeonScreen::DungeonScreen() :
-  text_("text.png"),
   camera_(),
   dungeon_set_(),
   player_(0, 0),
   state_(State::FadeIn),
   take_stairs_(false),
-  timer_(0)
+  timer_(0),
+  accumulator_(0),
+  pressed_a_(false), pressed_b_(false), pressed_select_(false), pressed_start_(false),
+  travel_(),
+  travel_target_({-1, -1}),
+  hud_(),
+  governor_(kFrameBudget),
+  map_(),
+  map_age_(0),
+  controls_(),
+  job_elapsed_(0),
+  busy_(false), stop_(false), running_(true),
+  back_(0), ready_(1), front_(2),
+  fresh_(false)
 {
   move_player_to_tile(Dungeon::Tile::StairsUp);
+  snapshot(frames_[ready_]);
+  fresh_ = true;
+
+  simulation_ = std::thread(&DungeonScreen::simulate, this);
+}
+
+DungeonScreen::~DungeonScreen() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  simulation_.join();
 }
 
+// Hands the frame to the simulation thread once it has finished the last
+// one, so the simulation runs while the previous frame is being drawn.
 bool DungeonScreen::update(const Input& input, Audio&, unsigned int elapsed) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this]{ return !busy_; });
+  if (!running_) return false;
+
+  controls_ = {
+    input.key_held(Input::Button::Left),
+    input.key_held(Input::Button::Right),
+    input.key_held(Input::Button::Up),
+    input.key_held(Input::Button::Down),
+    input.key_pressed(Input::Button::A),
+    input.key_pressed(Input::Button::B),
+    input.key_pressed(Input::Button::Select),
+    input.key_pressed(Input::Button::Start),
+  };
+  job_elapsed_ = elapsed;
+  busy_ = true;
+  wake_.notify_one();
+
+  return true;
+}
+
+void DungeonScreen::simulate() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this]{ return busy_ || stop_; });
+    if (stop_) return;
+
+    const Controls controls = controls_;
+    const unsigned int elapsed = job_elapsed_;
+    lock.unlock();
+
+    const bool running = advance(controls, elapsed);
+    snapshot(frames_[back_]);
+    govern();
+
+    lock.lock();
+    std::swap(back_, ready_);
+    fresh_ = true;
+    running_ = running;
+    busy_ = false;
+    idle_.notify_one();
+  }
+}
+
+bool DungeonScreen::advance(const Controls& controls, unsigned int elapsed) {
+  // Hold on to presses until there is a step to act on them.
+  if (controls.a) pressed_a_ = true;
+  if (controls.b) pressed_b_ = true;
+  if (controls.select) pressed_select_ = true;
+  if (controls.start) pressed_start_ = true;
+
+  accumulator_ = std::min(accumulator_ + elapsed, kStepTime * kMaxSteps);
+  while (accumulator_ >= kStepTime) {
+    accumulator_ -= kStepTime;
+    if (!step(controls)) return false;
+  }
+
+  return true;
+}
+
+bool DungeonScreen::step(const Controls& controls) {
+  const unsigned int elapsed = kStepTime;
   Dungeon& dungeon = dungeon_set_.current();
+  player_.save_position();
   auto pos = dungeon.grid_coords(player_.x(), player_.y());
   auto tile = dungeon.get_cell(pos.x, pos.y).tile;
 
+  // Nothing moves while the floor map is up.
+  if (state_ == State::Pause) {
+    if (pressed_start_) state_ = State::Playing;
+    pressed_a_ = false;
+    pressed_b_ = false;
+    pressed_select_ = false;
+    pressed_start_ = false;
+    return true;
+  }
+
   if (state_ == State::FadeIn) {
     timer_ += elapsed;
     if (timer_ > kFadeTimer) {
@@ -44,28 +148,53 @@ bool DungeonScreen::update(const Input& input, Audio&, unsigned int elapsed) {
       return true;
     }
   } else {
-    if (input.key_held(Input::Button::Left)) {
+    if (controls.left) {
       player_.move(Player::Direction::West);
-    } else if (input.key_held(Input::Button::Right)) {
+    } else if (controls.right) {
       player_.move(Player::Direction::East);
-    } else if (input.key_held(Input::Button::Up)) {
+    } else if (controls.up) {
       player_.move(Player::Direction::North);
-    } else if (input.key_held(Input::Button::Down)) {
+    } else if (controls.down) {
       player_.move(Player::Direction::South);
+    } else if (!travel_.empty()) {
+      follow_travel(dungeon);
     } else {
       player_.stop();
     }
 
-    if (input.key_pressed(Input::Button::A)) {
+    if (controls.left || controls.right || controls.up || controls.down) {
+      travel_.clear();
+    }
+
+    if (pressed_a_) {
+      travel_.clear();
       if (!player_.interact(dungeon)) player_.attack();
     }
 
+    if (pressed_b_) {
+      travel_.clear();
+      player_.throw_dagger(dungeon);
+    }
+
+    if (pressed_select_) {
+      const auto stairs = dungeon.find_tile(Dungeon::Tile::StairsDown);
+      if (dungeon.get_cell(stairs.x, stairs.y).seen) travel_to(dungeon, stairs);
+    }
+
+    if (pressed_start_) {
+      player_.stop();
+      state_ = State::Pause;
+    }
+
     if (player_.dead()) state_ = State::FadeOut;
   }
 
-  player_.update(dungeon, elapsed);
-  dungeon.update(player_, elapsed);
-  camera_.update(player_);
+  {
+    Governor::Timer timer(governor_, Governor::Subsystem::Simulation);
+    player_.update(dungeon, elapsed);
+    dungeon.update(player_, elapsed);
+    camera_.update(player_);
+  }
 
   if (tile == Dungeon::Tile::StairsUp) {
     if (take_stairs_) {
@@ -76,6 +205,7 @@ bool DungeonScreen::update(const Input& input, Audio&, unsigned int elapsed) {
         // probably add some sort of check for that and such
       } else {
         player_.stop();
+        travel_.clear();
         state_ = State::FadeOut;
       }
     }
@@ -83,49 +213,102 @@ bool DungeonScreen::update(const Input& input, Audio&, unsigned int elapsed) {
     if (take_stairs_) {
       take_stairs_ = false;
       player_.stop();
+      travel_.clear();
       state_ = State::FadeOut;
     }
   } else {
     take_stairs_ = true;
   }
 
-  dungeon.calculate_visibility(pos.x, pos.y);
+  {
+    Governor::Timer timer(governor_, Governor::Subsystem::Visibility);
+    dungeon.calculate_visibility(pos.x, pos.y);
+  }
+
+  pressed_a_ = false;
+  pressed_b_ = false;
+  pressed_select_ = false;
+  pressed_start_ = false;
 
   return true;
 }
 
+// Draws the newest finished frame.
 void DungeonScreen::draw(Graphics& graphics) const {
-  const int xo = camera_.xoffset();
-  const int yo = camera_.yoffset();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fresh_) {
+      std::swap(front_, ready_);
+      fresh_ = false;
+    }
+  }
+
+  frames_[front_].draw(graphics);
+}
+
+void DungeonScreen::snapshot(DrawList& list) {
+  // Draw everything where it was part way through the last step, and keep
+  // the camera on the player as drawn.  Nothing is between steps while paused.
+  const Fixed behind = state_ == State::Pause ? Fixed::from_raw(0) :
+    Fixed::from_raw((kStepTime - accumulator_) * Fixed::kOne / kStepTime);
+  const auto lag = player_.draw_lag(behind);
+  const int xo = camera_.xoffset() + lag.first;
+  const int yo = camera_.yoffset() + lag.second;
   const Dungeon& dungeon = dungeon_set_.current();
 
-  dungeon.draw(graphics, kHudHeight, xo, yo);
-  player_.draw(graphics, xo, yo);
+  list.begin(kConfig.graphics.width, kConfig.graphics.height);
+
+  {
+    Governor::Timer timer(governor_, Governor::Subsystem::World);
+    dungeon.draw(list, kHudHeight, xo, yo, behind);
+    player_.draw(list, xo - lag.first, yo - lag.second);
+  }
 
   if (state_ == State::FadeIn || state_ == State::FadeOut) {
     const double pct = timer_ / (double)kFadeTimer;
-    const int width = (int)((state_ == State::FadeOut ? pct : 1 - pct) * graphics.width() / 2);
+    const int width = (int)((state_ == State::FadeOut ? pct : 1 - pct) * list.width() / 2);
 
-    SDL_Rect r = { 0, 0, width, graphics.height() };
-    graphics.draw_rect(&r, 0x000000ff, true);
-    r.x = graphics.width() - width;
-    graphics.draw_rect(&r, 0x000000ff, true);
+    list.rect(DrawList::Layer::Screen, 0, 0, width, list.height(), 0x000000ff, true);
+    list.rect(DrawList::Layer::Screen, list.width() - width, 0, width, list.height(), 0x000000ff, true);
   }
 
-  SDL_Rect r = {0, 0, graphics.width(), kHudHeight};
-  graphics.draw_rect(&r, 0x000000ff, true);
+  list.rect(DrawList::Layer::Hud, 0, 0, list.width(), kHudHeight, 0x000000ff, true);
 
   const auto p = dungeon.grid_coords(player_.x(), player_.y());
-  const Rect map_region = {
-    (double)(p.x - kMapWidth / 2),
-    (double)(p.y - kMapHeight / 2),
-    (double)(p.x + kMapWidth / 2),
-    (double)(p.y + kMapHeight / 2),
-  };
-  dungeon.draw_map(graphics, map_region, { 0, 0, (double)kMapWidth, (double)kMapHeight });
-  player_.draw_hud(graphics, kMapWidth, 0);
-  text_.draw(graphics, "L", kMapWidth + 8, 32);
-  text_.draw(graphics, std::to_string(1 + dungeon_set_.floor()), kMapWidth + 48, 32, Text::Alignment::Right);
+  {
+    // Under pressure the minimap is only redone every few frames.
+    Governor::Timer timer(governor_, Governor::Subsystem::Map);
+    const int interval = governor_.at_least(Governor::Level::SlowMap) ? kSlowMapInterval : 1;
+    if (++map_age_ >= interval) {
+      map_age_ = 0;
+      const Rect map_region = {
+        p.x - kMapWidth / 2,
+        p.y - kMapHeight / 2,
+        p.x + kMapWidth / 2,
+        p.y + kMapHeight / 2,
+      };
+      map_.begin(list.width(), list.height());
+      dungeon.draw_map(map_, map_region, { 0, 0, kMapWidth, kMapHeight });
+    }
+    list.append(map_);
+  }
+
+  if (state_ == State::Pause) {
+    dungeon.draw_floor_map(list, { 0, kHudHeight, list.width(), list.height() }, p);
+  }
+  hud_.draw(list, player_, dungeon_set_.floor(), kMapWidth);
+
+  list.sort();
+}
+
+// Turns optional work down or back up for the next frame.
+void DungeonScreen::govern() {
+  governor_.end_frame();
+
+  const bool coarse = governor_.at_least(Governor::Level::CoarseZones);
+  dungeon_set_.current().set_coarse_tick_scale(coarse ? kCoarseTickScale : 1);
+
+  if (!governor_.at_least(Governor::Level::NoPregeneration)) dungeon_set_.prepare();
 }
 
 Screen* DungeonScreen::next_screen() const {
@@ -140,3 +323,52 @@ void DungeonScreen::move_player_to_tile(Dungeon::Tile tile) {
   auto p = dungeon_set_.current().find_tile(tile);
   player_.set_position(p.x * 16 + 8, p.y * 16 + 8);
 }
+
+void DungeonScreen::travel_to(Dungeon& dungeon, Dungeon::Position target) {
+  const auto p = dungeon.grid_coords(player_.x(), player_.y());
+  travel_ = dungeon.find_path(p, target, player_.keys() > 0);
+  std::reverse(travel_.begin(), travel_.end());
+  travel_target_ = target;
+}
+
+void DungeonScreen::follow_travel(Dungeon& dungeon) {
+  const auto p = dungeon.grid_coords(player_.x(), player_.y());
+  const auto next = travel_.back();
+
+  // Knocked off the path, so find a new one from here.
+  if (std::abs(next.x - p.x) + std::abs(next.y - p.y) > 1) {
+    travel_to(dungeon, travel_target_);
+    if (travel_.empty()) player_.stop();
+    return;
+  }
+
+  // Line up with the middle of the current tile before stepping off it so
+  // the player doesn't catch on the corners of doorways.
+  int dx = p.x * 16 + 8 - player_.x().to_int();
+  int dy = p.y * 16 + 8 - player_.y().to_int();
+
+  if (p.x == next.x && p.y == next.y) {
+    if (std::abs(dx) <= 2 && std::abs(dy) <= 2) {
+      travel_.pop_back();
+      if (travel_.empty()) player_.stop();
+      return;
+    }
+  } else if (next.x != p.x && std::abs(dy) <= 2) {
+    dx = next.x - p.x;
+    dy = 0;
+  } else if (next.y != p.y && std::abs(dx) <= 2) {
+    dx = 0;
+    dy = next.y - p.y;
+  }
+
+  if (std::abs(dx) > std::abs(dy)) {
+    player_.move(dx < 0 ? Player::Direction::West : Player::Direction::East);
+  } else {
+    player_.move(dy < 0 ? Player::Direction::North : Player::Direction::South);
+  }
+
+  const auto tile = dungeon.get_cell(next.x, next.y).tile;
+  if (tile == Dungeon::Tile::DoorClosed || tile == Dungeon::Tile::DoorLocked) {
+    player_.interact(dungeon);
+  }
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "audio.h"
 #include "backdrop.h"
 #include "graphics.h"
@@ -8,13 +12,17 @@
 #include "text.h"
 
 #include "camera.h"
+#include "draw_list.h"
 #include "dungeon_set.h"
+#include "governor.h"
+#include "hud.h"
 #include "player.h"
 
 class DungeonScreen : public Screen {
   public:
 
     DungeonScreen();
+    ~DungeonScreen();
 
     bool update(const Input& input, Audio& audio, unsigned int elapsed) override;
     void draw(Graphics& graphics) const override;
@@ -31,13 +39,63 @@ class DungeonScreen : public Screen {
     static constexpr int kMapWidth = kMapHeight * 4/3;
     static constexpr int kFadeTimer = 1000;
 
-    Text text_;
+    // The simulation always advances in steps of the same length, and frames
+    // that run long catch up by at most kMaxSteps of them.
+    static constexpr unsigned int kStepTime = 10;
+    static constexpr unsigned int kMaxSteps = 10;
+
+    // Microseconds the simulation thread has for each frame, and how much it
+    // cuts back when that isn't enough.
+    static constexpr unsigned int kFrameBudget = 1000000 / 60;
+    static constexpr int kSlowMapInterval = 4;
+    static constexpr unsigned int kCoarseTickScale = 4;
+
+    // What was held and pressed on a frame, copied out of Input for the
+    // simulation thread.
+    struct Controls {
+      bool left, right, up, down;
+      bool a, b, select, start;
+    };
+
     Camera camera_;
     DungeonSet dungeon_set_;
     Player player_;
     State state_;
     bool take_stairs_;
     int timer_;
+    unsigned int accumulator_;
+    bool pressed_a_, pressed_b_, pressed_select_, pressed_start_;
+
+    // Tiles left to walk for auto-travel, the next one at the back.
+    std::vector<Dungeon::Position> travel_;
+    Dungeon::Position travel_target_;
+
+    Hud hud_;
+    Governor governor_;
+    DrawList map_;
+    int map_age_;
+
+    // The simulation runs on its own thread, one job per frame, and finishes
+    // each job with a draw list of how things look.  The lists go round in a
+    // triple buffer so drawing never waits on the simulation or the other
+    // way around.
+    mutable std::mutex mutex_;
+    std::condition_variable wake_, idle_;
+    Controls controls_;
+    unsigned int job_elapsed_;
+    bool busy_, stop_, running_;
+    DrawList frames_[3];
+    int back_;
+    mutable int ready_, front_;
+    mutable bool fresh_;
+    std::thread simulation_;
 
+    void simulate();
+    bool advance(const Controls& controls, unsigned int elapsed);
+    bool step(const Controls& controls);
+    void snapshot(DrawList& list);
+    void govern();
     void move_player_to_tile(Dungeon::Tile tile);
+    void travel_to(Dungeon& dungeon, Dungeon::Position target);
+    void follow_travel(Dungeon& dungeon);
 };
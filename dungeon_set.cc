@@ -3,20 +3,21 @@
 #include "util.h"
 
 #include "log.h"
+#include "random.h"
 
 DungeonSet::DungeonSet() : DungeonSet(Util::random_seed()) {}
 
-DungeonSet::DungeonSet(unsigned int seed) : floors_(), rand_(seed), current_floor_(0) {
+DungeonSet::DungeonSet(uint64_t seed) : floors_(), seed_(seed), current_floor_(0), next_() {
   DEBUG_LOG << "Dungeon set seed " << seed << "\n";
   generate_floor();
 }
 
 const Dungeon& DungeonSet::get_floor(size_t floor) const {
-  return floors_[floor];
+  return *floors_[floor];
 }
 
 Dungeon& DungeonSet::get_floor(size_t floor) {
-  return floors_[floor];
+  return *floors_[floor];
 }
 
 const Dungeon& DungeonSet::current() const {
@@ -40,10 +41,19 @@ void DungeonSet::down() {
   if (current_floor_ >= floors_.size()) generate_floor();
 }
 
-void DungeonSet::generate_floor() {
-  const int floor = floors_.size();
+void DungeonSet::prepare() {
+  if (next_.valid() || current_floor_ + 1 < floors_.size()) return;
+  next_ = std::async(std::launch::async, make_floor, seed_, floors_.size());
+}
+
+std::unique_ptr<Dungeon> DungeonSet::make_floor(uint64_t seed, size_t floor) {
   DEBUG_LOG << "Generating floor " << floor << "\n";
   // TODO change parameters for each floor
-  floors_.emplace_back(59, 79, Dungeon::TuningParams{1.0, 0.75,  0.02, 3});
-  floors_[floor].generate(rand_());
+  std::unique_ptr<Dungeon> dungeon(new Dungeon(59, 79, Dungeon::TuningParams{1.0, 0.75,  0.02, 3}));
+  dungeon->generate(Random::derive(seed, floor));
+  return dungeon;
+}
+
+void DungeonSet::generate_floor() {
+  floors_.push_back(next_.valid() ? next_.get() : make_floor(seed_, floors_.size()));
 }
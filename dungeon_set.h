@@ -1,5 +1,8 @@
 #pragma once
 
+#include <future>
+#include <memory>
+
 #include "dungeon.h"
 #include "entity.h"
 
@@ -7,7 +10,7 @@ class DungeonSet {
   public:
 
     DungeonSet();
-    DungeonSet(unsigned int seed);
+    DungeonSet(uint64_t seed);
 
     const Dungeon& get_floor(size_t floor) const;
     Dungeon& get_floor(size_t floor);
@@ -19,13 +22,20 @@ class DungeonSet {
     void up();
     void down();
 
+    // Starts generating the floor below the current one in the background,
+    // if it doesn't exist yet, so going down doesn't have to wait for it.
+    void prepare();
+
   private:
 
     static size_t random_seed();
 
-    std::vector<Dungeon> floors_;
-    std::default_random_engine rand_;
+    std::vector<std::unique_ptr<Dungeon>> floors_;
+    uint64_t seed_;
     size_t current_floor_;
+    std::future<std::unique_ptr<Dungeon>> next_;
+
+    static std::unique_ptr<Dungeon> make_floor(uint64_t seed, size_t floor);
 
     void generate_floor();
 };
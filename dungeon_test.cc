@@ -0,0 +1,188 @@
+#include <cstdio>
+#include <memory>
+
+#include "dungeon.h"
+#include "player.h"
+
+// Checks the tile sweep against a room corner found in a generated floor,
+// that a thrown dagger hits a slime that is asleep in its path, and that a
+// slime killed after being woken early is not woken again.
+
+namespace {
+  int failures = 0;
+
+  // Kills anything it hits in one go, and counts how many times that was.
+  class Killer : public Player {
+    public:
+      Killer(int x, int y) : Player(x, y), kills_(0) {}
+
+      int damage() const override {
+        ++kills_;
+        return 100;
+      }
+
+      int kills() const { return kills_; }
+
+    private:
+      mutable int kills_;
+  };
+
+  void expect(bool ok, const char* what) {
+    if (!ok) {
+      std::fprintf(stderr, "FAILED: %s\n", what);
+      ++failures;
+    }
+  }
+
+  void expect_sweep(const Dungeon& dungeon, const Rect& box, int dx, int dy, int ex, int ey, const char* what) {
+    const auto d = dungeon.sweep(box, dx, dy);
+    if (d.x != ex || d.y != ey) {
+      std::fprintf(stderr, "FAILED: %s: moved %d,%d, expected %d,%d\n", what, d.x, d.y, ex, ey);
+      ++failures;
+    }
+  }
+
+  // The top left tile of a clear 5x5 block with wall along its top and left.
+  Dungeon::Position find_corner(const Dungeon& dungeon, int width, int height) {
+    for (int y = 1; y < height - 5; ++y) {
+      for (int x = 1; x < width - 5; ++x) {
+        bool ok = true;
+        for (int i = 0; i < 5 && ok; ++i) {
+          ok = !dungeon.walkable(x - 1, y + i) && !dungeon.walkable(x + i, y - 1);
+          for (int j = 0; j < 5 && ok; ++j) ok = dungeon.walkable(x + i, y + j);
+        }
+        if (ok) return { x, y };
+      }
+    }
+    return { -1, -1 };
+  }
+
+  // The left end of a clear run of tiles along a row with nothing on or
+  // near it.
+  Dungeon::Position find_run(const Dungeon& dungeon, int width, int height, int length) {
+    for (int y = 3; y < height - 3; ++y) {
+      for (int x = 3; x < width - length - 3; ++x) {
+        bool ok = true;
+        for (int i = 0; i < length && ok; ++i) ok = dungeon.walkable(x + i, y);
+        for (int iy = y - 3; iy <= y + 3 && ok; ++iy) {
+          for (int ix = x - 3; ix < x + length + 3 && ok; ++ix) ok = !dungeon.any_entity_at(ix, iy);
+        }
+        if (ok) return { x, y };
+      }
+    }
+    return { -1, -1 };
+  }
+
+  void test_sweep(const Dungeon& dungeon, int width, int height) {
+    const auto corner = find_corner(dungeon, width, height);
+    expect(corner.x >= 0, "found a room corner");
+    if (corner.x < 0) return;
+
+    // Pixel coordinates of the room's left and top edges.
+    const int px = corner.x * 16;
+    const int py = corner.y * 16;
+    const Rect box(px + 20, py + 20, px + 35, py + 27);
+
+    expect_sweep(dungeon, box, 0, 0, 0, 0, "no move");
+    expect_sweep(dungeon, box, 3, 5, 3, 5, "open move");
+
+    // Stopping flush against the wall, and staying there.
+    expect_sweep(dungeon, Rect(px + 3, py + 20, px + 18, py + 27), -10, 0, -3, 0, "stop at left wall");
+    expect_sweep(dungeon, Rect(px, py + 20, px + 15, py + 27), -5, 0, 0, 0, "flush against left wall");
+    expect_sweep(dungeon, Rect(px + 20, py + 3, px + 35, py + 10), 0, -10, 0, -3, "stop at top wall");
+    expect_sweep(dungeon, Rect(px + 20, py, px + 35, py + 7), 0, -5, 0, 0, "flush against top wall");
+
+    // Negative moves over more than one tile that land exactly on the edge.
+    expect_sweep(dungeon, box, -20, 0, -20, 0, "left onto tile boundary");
+    expect_sweep(dungeon, box, -37, 0, -20, 0, "left past tile boundary");
+    expect_sweep(dungeon, box, 0, -20, 0, -20, "up onto tile boundary");
+    expect_sweep(dungeon, box, 0, -37, 0, -20, "up past tile boundary");
+
+    // Positive moves over more than one tile.
+    expect_sweep(dungeon, Rect(px, py, px + 15, py + 15), 32, 0, 32, 0, "right across two tiles");
+    expect_sweep(dungeon, Rect(px, py, px + 15, py + 15), 0, 32, 0, 32, "down across two tiles");
+
+    // Sliding along a wall keeps the move along it.
+    expect_sweep(dungeon, Rect(px + 20, py, px + 35, py + 7), 20, -5, 20, 0, "slide along top wall");
+    expect_sweep(dungeon, Rect(px, py + 20, px + 15, py + 27), -5, 20, 0, 20, "slide along left wall");
+
+    // Partly inside a wall: no deeper, but back out is fine.
+    expect_sweep(dungeon, Rect(px - 4, py + 20, px + 11, py + 27), -3, 0, 0, 0, "no deeper into left wall");
+    expect_sweep(dungeon, Rect(px - 4, py + 20, px + 11, py + 27), 6, 0, 6, 0, "out of left wall");
+    expect_sweep(dungeon, Rect(px + 20, py - 4, px + 35, py + 3), 0, -3, 0, 0, "no deeper into top wall");
+    expect_sweep(dungeon, Rect(px + 20, py - 4, px + 35, py + 3), 0, 6, 0, 6, "out of top wall");
+
+    // Buried in the wall column, as when a door shuts on something.
+    expect_sweep(dungeon, Rect(px - 16, py + 20, px - 1, py + 27), 16, 0, 16, 0, "out of a buried column");
+  }
+
+  // A waiting slime this far from the player sleeps until after the dagger
+  // would have flown past it and run out.
+  void test_sleeping_target(Dungeon& dungeon, int width, int height) {
+    constexpr int kSlimeDistance = 100;
+
+    const auto run = find_run(dungeon, width, height, 9);
+    expect(run.x >= 0, "found a clear run of tiles");
+    if (run.x < 0) return;
+
+    const int px = run.x * 16 + 8;
+    const int py = run.y * 16 + 8;
+    Player player(px, py);
+    dungeon.add_slime(px + kSlimeDistance, py);
+    const auto slime = dungeon.grid_coords(px + kSlimeDistance, py);
+
+    // Give the slime a step to fall asleep.
+    dungeon.update(player, 10);
+    expect(dungeon.any_entity_at(slime.x, slime.y), "slime in place");
+
+    expect(dungeon.launch(Projectiles::Kind::Dagger, player.x(), player.y(), Entity::Direction::East), "dagger thrown");
+
+    // Knocked back out of its tile if it was hit, since otherwise it just
+    // sits there.
+    for (int t = 0; t < 600; t += 10) dungeon.update(player, 10);
+    expect(!dungeon.any_entity_at(slime.x, slime.y), "sleeping slime hit by dagger");
+  }
+
+  // Thrown from next to a slime far enough from the player to sleep for a
+  // long time, the dagger wakes it and it dies well before it would have
+  // woken by itself, so its entry in the timer wheel then goes off for a
+  // slot that has already been released.
+  void test_killed_sleeper(Dungeon& dungeon, int width, int height) {
+    constexpr int kSlimeDistance = 150;
+    constexpr int kThrowDistance = 120;
+    constexpr int kLength = 12;
+
+    const auto run = find_run(dungeon, width, height, kLength);
+    expect(run.x >= 0, "found a clear run of tiles");
+    if (run.x < 0) return;
+
+    const int px = run.x * 16 + 8;
+    const int py = run.y * 16 + 8;
+    Killer player(px, py);
+    dungeon.add_slime(px + kSlimeDistance, py);
+
+    dungeon.update(player, 10);
+    expect(dungeon.launch(Projectiles::Kind::Dagger, player.x() + kThrowDistance, player.y(), Entity::Direction::East),
+        "dagger thrown");
+
+    for (int t = 0; t < 2000; t += 10) dungeon.update(player, 10);
+    expect(player.kills() == 1, "woken slime killed by dagger");
+  }
+}
+
+int main() {
+  const int width = 79, height = 59;
+  std::unique_ptr<Dungeon> floor(new Dungeon(width, height, Dungeon::TuningParams{1.0, 0.75, 0.02, 3}));
+  Dungeon& dungeon = *floor;
+  dungeon.generate(1);
+
+  test_sweep(dungeon, width, height);
+  test_sleeping_target(dungeon, width, height);
+
+  std::unique_ptr<Dungeon> other(new Dungeon(width, height, Dungeon::TuningParams{1.0, 0.75, 0.02, 3}));
+  other->generate(1);
+  test_killed_sleeper(*other, width, height);
+
+  if (failures == 0) std::printf("PASSED\n");
+  return failures == 0 ? 0 : 1;
+}
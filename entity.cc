@@ -1,8 +1,6 @@
 #include "entity.h"
 
-#include <random>
-
-#include "util.h"
+#include "dungeon.h"
 
 Entity::Direction Entity::reverse_direction(Direction d) {
   switch (d) {
@@ -16,7 +14,7 @@ Entity::Direction Entity::reverse_direction(Direction d) {
   return Direction::North;
 }
 
-std::pair<double, double> Entity::delta_direction(Direction d, double amount) {
+std::pair<Fixed, Fixed> Entity::delta_direction(Direction d, Fixed amount) {
   switch (d) {
     case Direction::North: return { 0, -amount };
     case Direction::South: return { 0, amount };
@@ -27,27 +25,63 @@ std::pair<double, double> Entity::delta_direction(Direction d, double amount) {
   return {0, 0};
 }
 
-Entity::Entity(std::string sprites, int cols, double x, double y, int hp) :
-  sprites_(sprites, cols, kTileSize, kTileSize),
-  x_(x), y_(y),
+Entity::Entity(const SpriteMap& sprites, Fixed x, Fixed y, int hp) :
+  sprites_(sprites),
+  x_(x), y_(y), saved_x_(x), saved_y_(y), saved_at_(0),
   facing_(Direction::South), knockback_(facing_),
   state_(State::Waiting),
   timer_(0), iframes_(0), kbtimer_(0),
   maxhp_(hp), curhp_(maxhp_),
   dead_(false),
-  rd_(Util::random_seed()) {}
+  rd_(0, 0) {}
 
-double Entity::x() const {
+Fixed Entity::x() const {
   return x_;
 }
 
-double Entity::y() const {
+Fixed Entity::y() const {
   return y_;
 }
 
-void Entity::set_position(double x, double y) {
-  x_ = x;
-  y_ = y;
+int Entity::hp() const {
+  return curhp_;
+}
+
+int Entity::max_hp() const {
+  return maxhp_;
+}
+
+void Entity::set_position(Fixed x, Fixed y) {
+  x_ = saved_x_ = x;
+  y_ = saved_y_ = y;
+}
+
+void Entity::save_position() {
+  saved_x_ = x_;
+  saved_y_ = y_;
+}
+
+// Also remembers when, so something that hasn't moved since can be drawn
+// where it is.
+void Entity::save_position(unsigned int time) {
+  save_position();
+  saved_at_ = time;
+}
+
+unsigned int Entity::saved_at() const {
+  return saved_at_;
+}
+
+// How many pixels away from its current position the entity should be drawn
+// to be the given fraction of a step behind, back toward the saved position.
+std::pair<int, int> Entity::draw_lag(Fixed behind) const {
+  const Fixed x = x_ + (saved_x_ - x_) * behind;
+  const Fixed y = y_ + (saved_y_ - y_) * behind;
+  return { x.to_int() - x_.to_int(), y.to_int() - y_.to_int() };
+}
+
+void Entity::seed(uint64_t seed, uint64_t stream) {
+  rd_ = Random(seed, stream);
 }
 
 void Entity::ai(const Dungeon&, const Entity&) {}
@@ -56,7 +90,7 @@ void Entity::update_generic(const Dungeon& dungeon, unsigned int elapsed) {
   if (iframes_ > 0) iframes_ = std::max(0, iframes_ - (int)elapsed);
 
   if (kbtimer_ > 0) {
-    const double delta = kKnockbackSpeed * std::min(kbtimer_, (int)elapsed);
+    const Fixed delta = kKnockbackSpeed * std::min(kbtimer_, (int)elapsed);
     kbtimer_ = std::max(0, kbtimer_ - (int)elapsed);
     auto d = Entity::delta_direction(knockback_, delta);
     move_if_possible(dungeon, d.first, d.second);
@@ -77,22 +111,22 @@ void Entity::update(Dungeon& dungeon, unsigned int elapsed) {
   }
 }
 
-void Entity::draw(Graphics& graphics, int xo, int yo) const {
+void Entity::draw(DrawList& list, int xo, int yo) const {
   if (iframes_ > 0 && (iframes_ / 32) % 2 == 0) return;
 
-  const int x = (int)x_ - kHalfTile - xo;
-  const int y = (int)y_ - kHalfTile - yo;
+  const int x = x_.to_int() - kHalfTile - xo;
+  const int y = y_.to_int() - kHalfTile - yo;
 
   if (state_ == State::Dying) {
     int n = timer_ / kDeathFrame;
     if (n > 2) n = 4 - n;
-    sprites_.draw(graphics, n + 8, x, y);
+    list.sprite(DrawList::Layer::Entities, sprites_, n + 8, x, y);
   } else {
-    sprites_.draw_ex(graphics, sprite_number(), x, y, facing_ == Direction::West, 0, 0, 0);
+    list.sprite(DrawList::Layer::Entities, sprites_, sprite_number(), x, y, facing_ == Direction::West);
   }
 
 #ifndef NDEBUG
-  hit_box().draw(graphics, 0xffffff80, false, xo, yo);
+  hit_box().draw(list, DrawList::Layer::Front, 0xffffff80, false, xo, yo);
 #endif
 }
 
@@ -104,6 +138,13 @@ bool Entity::alive() const {
   return !dead_ && state_ != State::Dying;
 }
 
+// How long this entity can go without ai or updates, or 0 if it needs them
+// every frame.  Nothing is touched while it sleeps, so sleeping has to end
+// before the target could get close enough to interact with it.
+int Entity::sleep_time(const Entity&) const {
+  return 0;
+}
+
 void Entity::hit(Entity& source) {
   if (curhp_ == 0 || iframes_ > 0) return;
 
@@ -115,10 +156,10 @@ void Entity::hit(Entity& source) {
     return;
   }
 
-  const double dx = source.x() - x_;
-  const double dy = source.y() - y_;
+  const Fixed dx = source.x() - x_;
+  const Fixed dy = source.y() - y_;
 
-  if (std::abs(dy) > std::abs(dx)) {
+  if (dy.abs() > dx.abs()) {
     knockback_ = dy > 0 ? Direction::North : Direction::South;
   } else {
     knockback_ = dx > 0 ? Direction::West : Direction::East;
@@ -128,6 +169,11 @@ void Entity::hit(Entity& source) {
   iframes_ = kIFrameTime;
 }
 
+// Whether a hit now would do anything.
+bool Entity::vulnerable() const {
+  return curhp_ > 0 && iframes_ == 0;
+}
+
 void Entity::heal(int hp) {
   curhp_ = std::min(maxhp_, curhp_ + hp);
 }
@@ -141,9 +187,11 @@ int Entity::sprite_number() const {
 }
 
 Rect Entity::collision_box() const {
+  const int x = x_.to_int();
+  const int y = y_.to_int();
   return {
-    x_ - kHalfTile + 1, y_ - kHalfTile + 1,
-    x_ + kHalfTile - 1, y_ + kHalfTile - 1
+    x - kHalfTile + 1, y - kHalfTile + 1,
+    x + kHalfTile - 1, y + kHalfTile - 1
   };
 }
 
@@ -159,18 +207,59 @@ Rect Entity::defense_box() const {
   return { 0, 0, 0, 0 };
 }
 
-bool Entity::move_if_possible(const Dungeon& dungeon, double dx, double dy) {
-  x_ += dx; y_ += dy;
-  if (!collision(dungeon)) return true;
-  x_ -= dx; y_ -= dy;
+// Moves as far as the tiles allow and reports whether the whole move was made.
+bool Entity::move_if_possible(const Dungeon& dungeon, Fixed dx, Fixed dy) {
+  Fixed nx = x_ + dx;
+  Fixed ny = y_ + dy;
+
+  if (tile_collision()) {
+    // Boxes are whole pixels, so sweep the pixel move and then put the
+    // position at the last sub-pixel that still maps to the allowed pixel.
+    const int px = nx.to_int() - x_.to_int();
+    const int py = ny.to_int() - y_.to_int();
+    const auto d = dungeon.sweep(collision_box(), px, py);
+
+    if (d.x != px) {
+      nx = px > 0 ? Fixed(x_.to_int() + d.x + 1) - Fixed::epsilon() : Fixed(x_.to_int() + d.x);
+    }
+    if (d.y != py) {
+      ny = py > 0 ? Fixed(y_.to_int() + d.y + 1) - Fixed::epsilon() : Fixed(y_.to_int() + d.y);
+    }
+  }
+
+  const Fixed mx = nx - x_;
+  const Fixed my = ny - y_;
+
+  x_ += mx; y_ += my;
+  if (!collision(dungeon)) return mx == dx && my == dy;
+  x_ -= mx; y_ -= my;
   return false;
 }
 
-bool Entity::collision(const Dungeon& dungeon) const {
-  return !dungeon.box_walkable(collision_box());
+// Collision with anything other than tiles, which are handled by the sweep.
+bool Entity::collision(const Dungeon&) const {
+  return false;
+}
+
+bool Entity::tile_collision() const {
+  return true;
 }
 
 void Entity::state_transition(State state) {
   state_ = state;
   timer_ = 0;
 }
+
+bool Entity::settled() const {
+  return iframes_ == 0 && kbtimer_ == 0 && alive();
+}
+
+// Lower bound on the time before the target could be within range on both
+// axes, given that nothing closes in faster than one pixel per kPixelTime.
+int Entity::time_to_reach(const Entity& target, int range) const {
+  const int dx = (target.x() - x_).abs().to_int();
+  const int dy = (target.y() - y_).abs().to_int();
+  return std::max(0, (std::max(dx, dy) - range) * kPixelTime);
+}
+
+constexpr Fixed Entity::kKnockbackSpeed;
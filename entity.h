@@ -1,33 +1,47 @@
 #pragma once
 
-#include <string>
-
 #include "graphics.h"
 #include "spritemap.h"
-#include "dungeon.h"
+
+#include "draw_list.h"
+#include "fixed.h"
+#include "random.h"
 #include "rect.h"
 
+// Entities only ever see the dungeon by reference, which lets the dungeon
+// store them by value.
+class Dungeon;
+
 class Entity {
   public:
 
     enum class Direction { North, East, South, West };
 
     static Direction reverse_direction(Direction d);
-    static std::pair<double, double> delta_direction(Direction d, double amount);
+    static std::pair<Fixed, Fixed> delta_direction(Direction d, Fixed amount);
 
-    Entity(std::string sprites, int cols, double x, double y, int hp);
+    Entity(const SpriteMap& sprites, Fixed x, Fixed y, int hp);
 
-    double x() const;
-    double y() const;
-    void set_position(double x, double y);
+    Fixed x() const;
+    Fixed y() const;
+    int hp() const;
+    int max_hp() const;
+    void set_position(Fixed x, Fixed y);
+    void save_position();
+    void save_position(unsigned int time);
+    unsigned int saved_at() const;
+    std::pair<int, int> draw_lag(Fixed behind) const;
+    void seed(uint64_t seed, uint64_t stream);
 
     virtual void ai(const Dungeon& dungeon, const Entity& target);
     virtual void update(Dungeon& dungeon, unsigned int elapsed);
-    virtual void draw(Graphics& graphics, int xo, int yo) const;
+    virtual void draw(DrawList& list, int xo, int yo) const;
     virtual bool dead() const;
     virtual bool alive() const;
+    virtual int sleep_time(const Entity& target) const;
 
     virtual void hit(Entity& source);
+    bool vulnerable() const;
     void heal(int hp);
 
     virtual int damage() const;
@@ -45,23 +59,29 @@ class Entity {
     static constexpr int kDeathTime = kDeathFrame * 5;
     static constexpr int kIFrameTime = 500;
     static constexpr int kKnockbackTime = kIFrameTime / 2;
-    static constexpr double kKnockbackSpeed = 0.1;
+    static constexpr Fixed kKnockbackSpeed = Fixed::from_double(0.1);
+    static constexpr int kPixelTime = 10;
+    static constexpr int kContactRange = kTileSize * 3;
 
     enum class State { Waiting, Walking, Attacking, Holding, Retreating, Dying };
 
-    SpriteMap sprites_;
-    double x_, y_;
+    const SpriteMap& sprites_;
+    Fixed x_, y_, saved_x_, saved_y_;
+    unsigned int saved_at_;
     Direction facing_, knockback_;
     State state_;
     int timer_, iframes_, kbtimer_;
     int maxhp_, curhp_;
     bool dead_;
-    std::default_random_engine rd_;
+    Random rd_;
 
     virtual int sprite_number() const;
     virtual bool collision(const Dungeon& dungeon) const;
+    virtual bool tile_collision() const;
 
-    bool move_if_possible(const Dungeon& dungeon, double dx, double dy);
+    bool move_if_possible(const Dungeon& dungeon, Fixed dx, Fixed dy);
     void state_transition(State state);
+    bool settled() const;
+    int time_to_reach(const Entity& target, int range) const;
     void update_generic(const Dungeon& dungeon, unsigned int elapsed);
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+// Fixed point number with 16 bits of fraction, used for sub-pixel positions
+// and speeds so that the simulation is the same on every compiler.
+class Fixed {
+  public:
+
+    static constexpr int kShift = 16;
+    static constexpr int32_t kOne = 1 << kShift;
+
+    constexpr Fixed() : raw_(0) {}
+    constexpr Fixed(int pixels) : raw_(pixels * kOne) {}
+    Fixed(double) = delete;
+
+    static constexpr Fixed from_raw(int32_t raw) { return Fixed(raw, 0); }
+
+    // Only meant for compile time constants.
+    static constexpr Fixed from_double(double d) {
+      return from_raw(static_cast<int32_t>(d * kOne + (d < 0 ? -0.5 : 0.5)));
+    }
+
+    static constexpr Fixed epsilon() { return from_raw(1); }
+
+    constexpr int32_t raw() const { return raw_; }
+    constexpr int to_int() const { return raw_ >> kShift; }
+    constexpr double to_double() const { return raw_ / (double)kOne; }
+    Fixed abs() const { return from_raw(std::abs(raw_)); }
+
+    Fixed& operator+=(Fixed other) { raw_ += other.raw_; return *this; }
+    Fixed& operator-=(Fixed other) { raw_ -= other.raw_; return *this; }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return from_raw(a.raw_ + b.raw_); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return from_raw(a.raw_ - b.raw_); }
+    friend constexpr Fixed operator-(Fixed a) { return from_raw(-a.raw_); }
+    friend constexpr Fixed operator*(Fixed a, int b) { return from_raw(a.raw_ * b); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+      return from_raw(static_cast<int32_t>((static_cast<int64_t>(a.raw_) * b.raw_) >> kShift));
+    }
+    friend constexpr Fixed operator/(Fixed a, int b) { return from_raw(a.raw_ / b); }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw_ == b.raw_; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw_ != b.raw_; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw_ < b.raw_; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw_ > b.raw_; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw_ <= b.raw_; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw_ >= b.raw_; }
+
+  private:
+
+    constexpr Fixed(int32_t raw, int) : raw_(raw) {}
+
+    int32_t raw_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, Fixed f) {
+  os << f.to_double();
+  return os;
+}
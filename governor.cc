@@ -0,0 +1,64 @@
+#include "governor.h"
+
+#include "log.h"
+
+Governor::Timer::Timer(Governor& governor, Subsystem subsystem) :
+  governor_(governor), subsystem_(subsystem),
+  start_(std::chrono::steady_clock::now()) {}
+
+Governor::Timer::~Timer() {
+  const auto elapsed = std::chrono::steady_clock::now() - start_;
+  governor_.add(subsystem_, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+Governor::Governor(unsigned int budget) :
+  budget_(budget), frame_(), smoothed_(), level_(0), over_(0), under_(0) {}
+
+void Governor::add(Subsystem subsystem, unsigned int micros) {
+  frame_[static_cast<int>(subsystem)] += micros;
+}
+
+void Governor::end_frame() {
+  for (int i = 0; i < kSubsystems; ++i) {
+    smoothed_[i] += (frame_[i] - smoothed_[i]) / kSmoothing;
+    frame_[i] = 0;
+  }
+
+  const unsigned int cost = total();
+  if (cost > budget_) {
+    under_ = 0;
+    if (++over_ >= kShedFrames && level_ < kLevels - 1) {
+      ++level_;
+      over_ = 0;
+      DEBUG_LOG << "Frames take " << cost << "us, shedding to level " << level_ << "\n";
+    }
+  } else if (cost * 100 < budget_ * kRestorePercent) {
+    over_ = 0;
+    if (++under_ >= kRestoreFrames && level_ > 0) {
+      --level_;
+      under_ = 0;
+      DEBUG_LOG << "Frames take " << cost << "us, restoring to level " << level_ << "\n";
+    }
+  } else {
+    over_ = 0;
+    under_ = 0;
+  }
+}
+
+Governor::Level Governor::level() const {
+  return static_cast<Level>(level_);
+}
+
+bool Governor::at_least(Level level) const {
+  return level_ >= static_cast<int>(level);
+}
+
+unsigned int Governor::cost(Subsystem subsystem) const {
+  return smoothed_[static_cast<int>(subsystem)];
+}
+
+unsigned int Governor::total() const {
+  unsigned int sum = 0;
+  for (int i = 0; i < kSubsystems; ++i) sum += smoothed_[i];
+  return sum;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+
+// Keeps each frame's work inside a budget.  The cost of every subsystem is
+// measured and smoothed, and while the total stays over budget optional work
+// is turned down one level at a time.  Levels only come back once there has
+// been plenty of room for a good while, so they don't flap at the edge.
+class Governor {
+  public:
+
+    enum class Subsystem { Simulation, Visibility, World, Map };
+
+    // Each level sheds the work of the ones before it as well.  Pregeneration
+    // goes last, since without it going down stalls on a whole floor.
+    enum class Level { Full, SlowMap, CoarseZones, NoPregeneration };
+
+    // Adds the time between construction and destruction to a subsystem.
+    class Timer {
+      public:
+        Timer(Governor& governor, Subsystem subsystem);
+        ~Timer();
+
+      private:
+        Governor& governor_;
+        Subsystem subsystem_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // The budget is in microseconds.
+    explicit Governor(unsigned int budget);
+
+    void add(Subsystem subsystem, unsigned int micros);
+    void end_frame();
+
+    Level level() const;
+    bool at_least(Level level) const;
+    unsigned int cost(Subsystem subsystem) const;
+    unsigned int total() const;
+
+  private:
+
+    static constexpr int kSubsystems = 4;
+    static constexpr int kLevels = 4;
+
+    // Costs are averaged over about this many frames.
+    static constexpr int kSmoothing = 8;
+    static constexpr int kShedFrames = 10;
+    static constexpr int kRestoreFrames = 120;
+    static constexpr int kRestorePercent = 60;
+
+    unsigned int budget_;
+    int frame_[kSubsystems], smoothed_[kSubsystems];
+    int level_, over_, under_;
+};
@@ -0,0 +1,50 @@
+#include "hud.h"
+
+#include <string>
+
+#include "assets.h"
+
+Hud::Hud() :
+  ui_(Assets::sprites(Assets::Sheet::Ui)),
+  text_(Assets::text()),
+  shown_({ -1, -1, -1, -1, -1, -1, -1 }),
+  cache_() {}
+
+void Hud::draw(DrawList& list, const Player& player, int floor, int x) {
+  const Status status = {
+    player.hp(), player.max_hp(), player.gold(), player.keys(),
+    floor, x, list.width(),
+  };
+
+  if (status != shown_) layout(status);
+  list.append(cache_);
+}
+
+bool Hud::Status::operator!=(const Status& other) const {
+  return hp != other.hp || max_hp != other.max_hp ||
+    gold != other.gold || keys != other.keys ||
+    floor != other.floor || x != other.x || width != other.width;
+}
+
+void Hud::layout(const Status& status) {
+  shown_ = status;
+  cache_.begin(status.width, 0);
+
+  const int hearts = status.max_hp / 4;
+  for (int h = 0; h < hearts; ++h) {
+    const int hx = status.width - kTileSize * (8 - h % 8);
+    const int hy = kTileSize * (h / 8);
+    const int n = (status.hp > (h + 1) * 4) ? 4 : (status.hp < h * 4) ? 0 : status.hp - h * 4;
+    cache_.sprite(DrawList::Layer::Hud, ui_, n, hx, hy);
+  }
+
+  const int x = status.x;
+  cache_.sprite(DrawList::Layer::Hud, ui_, 5, x + kHalfTile, 0);
+  cache_.text(DrawList::Layer::Hud, text_, std::to_string(status.gold), x + 3 * kTileSize, 0, Text::Alignment::Right);
+
+  cache_.sprite(DrawList::Layer::Hud, ui_, 9, x + kHalfTile, kTileSize);
+  cache_.text(DrawList::Layer::Hud, text_, std::to_string(status.keys), x + 3 * kTileSize, kTileSize, Text::Alignment::Right);
+
+  cache_.text(DrawList::Layer::Hud, text_, "L", x + 8, 2 * kTileSize);
+  cache_.text(DrawList::Layer::Hud, text_, std::to_string(1 + status.floor), x + 48, 2 * kTileSize, Text::Alignment::Right);
+}
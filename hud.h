@@ -0,0 +1,35 @@
+#pragma once
+
+#include "spritemap.h"
+#include "text.h"
+
+#include "draw_list.h"
+#include "player.h"
+
+// The hearts, gold, keys and floor along the top of the screen.  They only
+// change now and then, so the layout is kept and only redone when one of
+// them does.
+class Hud {
+  public:
+
+    Hud();
+
+    void draw(DrawList& list, const Player& player, int floor, int x);
+
+  private:
+
+    static constexpr int kTileSize = 16;
+    static constexpr int kHalfTile = kTileSize / 2;
+
+    struct Status {
+      int hp, max_hp, gold, keys, floor, x, width;
+      bool operator!=(const Status& other) const;
+    };
+
+    const SpriteMap& ui_;
+    const Text& text_;
+    Status shown_;
+    DrawList cache_;
+
+    void layout(const Status& status);
+};
@@ -0,0 +1,73 @@
+#include "particles.h"
+
+// In the same order as Effect.
+const Particles::Style Particles::kStyles[] = {
+  { 8, 8000, 0, 60, 200, 0xffee88ff },     // Sparks
+  { 8, 6000, 0, 60, 250, 0xff2222ff },     // Hurt
+  { 12, 2000, 1500, 0, 400, 0xaaaaaaff },  // Dust
+  { 6, 1500, 3000, 0, 350, 0xffff44ff },   // Glint
+};
+
+Particles::Particles() : count_(0), rd_(0, 0) {}
+
+void Particles::seed(uint64_t seed, uint64_t stream) {
+  rd_ = Random(seed, stream);
+}
+
+void Particles::emit(Effect effect, Fixed x, Fixed y) {
+  const Style& style = kStyles[static_cast<int>(effect)];
+
+  for (int n = 0; n < style.count && count_ < kCapacity; ++n) {
+    const size_t i = count_++;
+    x_[i] = x.raw();
+    y_[i] = y.raw();
+    vx_[i] = rd_.range(-style.speed, style.speed);
+    vy_[i] = rd_.range(-style.speed, style.speed) - style.rise;
+    gravity_[i] = style.gravity;
+    life_[i] = rd_.range(style.life / 2, style.life);
+    color_[i] = style.color;
+  }
+}
+
+void Particles::update(unsigned int elapsed) {
+  const int32_t t = elapsed;
+
+  // Nothing in here depends on any other particle, so it vectorizes.
+  for (size_t i = 0; i < count_; ++i) {
+    x_[i] += vx_[i] * t;
+    y_[i] += vy_[i] * t;
+    vy_[i] += gravity_[i] * t;
+    life_[i] -= t;
+  }
+
+  // The last particle takes the place of each one that has burnt out.
+  size_t i = 0;
+  while (i < count_) {
+    if (life_[i] > 0) {
+      ++i;
+      continue;
+    }
+
+    const size_t last = --count_;
+    x_[i] = x_[last];
+    y_[i] = y_[last];
+    vx_[i] = vx_[last];
+    vy_[i] = vy_[last];
+    gravity_[i] = gravity_[last];
+    life_[i] = life_[last];
+    color_[i] = color_[last];
+  }
+}
+
+void Particles::draw(DrawList& list, int xo, int yo) const {
+  for (size_t i = 0; i < count_; ++i) {
+    const int x = (x_[i] >> Fixed::kShift) - xo;
+    const int y = (y_[i] >> Fixed::kShift) - yo;
+    if (x < 0 || x >= list.width() || y < 0 || y >= list.height()) continue;
+    list.rect(DrawList::Layer::Effects, x, y, 1, 1, color_[i], true);
+  }
+}
+
+size_t Particles::size() const {
+  return count_;
+}
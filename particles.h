@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "draw_list.h"
+#include "fixed.h"
+#include "random.h"
+
+// Short lived specks for hits, deaths and pickups.  They are kept in
+// parallel arrays of a fixed size, so moving them all is one loop over plain
+// numbers with nothing allocated, and bursts that don't fit are cut short.
+class Particles {
+  public:
+
+    enum class Effect { Sparks, Hurt, Dust, Glint };
+
+    static constexpr size_t kCapacity = 4096;
+
+    Particles();
+
+    void seed(uint64_t seed, uint64_t stream);
+    void emit(Effect effect, Fixed x, Fixed y);
+    void update(unsigned int elapsed);
+    void draw(DrawList& list, int xo, int yo) const;
+
+    size_t size() const;
+
+  private:
+
+    // Speeds are in raw Fixed units per millisecond, gravity per millisecond
+    // squared.
+    struct Style {
+      int count, speed, rise, gravity, life;
+      uint32_t color;
+    };
+
+    static const Style kStyles[];
+
+    size_t count_;
+    int32_t x_[kCapacity], y_[kCapacity];
+    int32_t vx_[kCapacity], vy_[kCapacity], gravity_[kCapacity];
+    int32_t life_[kCapacity];
+    uint32_t color_[kCapacity];
+    Random rd_;
+};
@@ -0,0 +1,305 @@
+#include "pathfinder.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+  int distance(Pathfinder::Position a, Pathfinder::Position b) {
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+  }
+
+  int sign(int n) {
+    return (n > 0) - (n < 0);
+  }
+}
+
+Pathfinder::Pathfinder(int width, int height) :
+  width_(width), height_(height),
+  cells_(width * height, Cell::Blocked), dirty_(true),
+  areas_(width * height, -1), door_at_(width * height, -1),
+  cost_(width * height, 0), parent_(width * height, -1),
+  stamp_(width * height, 0), generation_(0) {}
+
+void Pathfinder::set(int x, int y, Cell cell) {
+  if (x < 0 || x >= width_) return;
+  if (y < 0 || y >= height_) return;
+
+  Cell& current = cells_[y * width_ + x];
+  if (current == cell) return;
+
+  current = cell;
+  dirty_ = true;
+}
+
+std::vector<Pathfinder::Position> Pathfinder::find_path(Position from, Position to, bool unlock) {
+  if (dirty_) build();
+
+  std::vector<Position> path;
+  if (at(from) == Cell::Blocked || at(to) == Cell::Blocked) return path;
+  if (!unlock && at(to) == Cell::Locked) return path;
+
+  std::vector<Position> waypoints;
+  if (!plan(from, to, unlock, waypoints)) return path;
+
+  Position leg = from;
+  for (const auto& w : waypoints) {
+    if (!jump_search(leg, w, path)) return {};
+    leg = w;
+  }
+
+  return path;
+}
+
+Pathfinder::Cell Pathfinder::at(Position p) const {
+  if (p.x < 0 || p.x >= width_) return Cell::Blocked;
+  if (p.y < 0 || p.y >= height_) return Cell::Blocked;
+  return cells_[p.y * width_ + p.x];
+}
+
+bool Pathfinder::passable(int x, int y, Position goal) const {
+  return at({x, y}) == Cell::Open || (x == goal.x && y == goal.y);
+}
+
+int Pathfinder::index(Position p) const {
+  return p.y * width_ + p.x;
+}
+
+void Pathfinder::build() {
+  dirty_ = false;
+
+  doors_.clear();
+  std::fill(areas_.begin(), areas_.end(), -1);
+  std::fill(door_at_.begin(), door_at_.end(), -1);
+
+  for (int i = 0; i < width_ * height_; ++i) {
+    if (cells_[i] != Cell::Door && cells_[i] != Cell::Locked) continue;
+    door_at_[i] = doors_.size();
+    doors_.push_back({ { i % width_, i / width_ }, cells_[i] == Cell::Locked, {} });
+  }
+
+  int area = 0;
+  for (int i = 0; i < width_ * height_; ++i) {
+    if (cells_[i] != Cell::Open || areas_[i] >= 0) continue;
+
+    queue_.clear();
+    queue_.push_back(i);
+    areas_[i] = area;
+
+    for (size_t q = 0; q < queue_.size(); ++q) {
+      const Position p = { queue_[q] % width_, queue_[q] / width_ };
+      const Position neighbors[] = { {p.x, p.y - 1}, {p.x + 1, p.y}, {p.x, p.y + 1}, {p.x - 1, p.y} };
+      for (const auto& n : neighbors) {
+        if (at(n) != Cell::Open || areas_[index(n)] >= 0) continue;
+        areas_[index(n)] = area;
+        queue_.push_back(index(n));
+      }
+    }
+
+    ++area;
+  }
+
+  for (auto& door : doors_) reach_doors(door.pos, door.edges);
+}
+
+// Walking distance to every door that can be reached from a cell without
+// going through another door.
+void Pathfinder::reach_doors(Position from, std::vector<Edge>& edges) {
+  ++generation_;
+  queue_.clear();
+  queue_.push_back(index(from));
+  stamp_[index(from)] = generation_;
+  cost_[index(from)] = 0;
+
+  for (size_t q = 0; q < queue_.size(); ++q) {
+    const int c = queue_[q];
+    const Position p = { c % width_, c / width_ };
+    const Position neighbors[] = { {p.x, p.y - 1}, {p.x + 1, p.y}, {p.x, p.y + 1}, {p.x - 1, p.y} };
+    for (const auto& n : neighbors) {
+      const Cell cell = at(n);
+      if (cell == Cell::Blocked) continue;
+
+      const int i = index(n);
+      if (stamp_[i] == generation_) continue;
+      stamp_[i] = generation_;
+      cost_[i] = cost_[c] + 1;
+
+      if (cell == Cell::Door || cell == Cell::Locked) {
+        edges.push_back({ door_at_[i], cost_[i] });
+      } else {
+        queue_.push_back(i);
+      }
+    }
+  }
+}
+
+// Picks the doors to go through, ending with the destination itself.
+bool Pathfinder::plan(Position from, Position to, bool unlock, std::vector<Position>& waypoints) {
+  const int area = areas_[index(from)];
+  if (area >= 0 && area == areas_[index(to)]) {
+    waypoints.push_back(to);
+    return true;
+  }
+
+  std::vector<Edge> starts, goals;
+  if (door_at_[index(from)] >= 0) {
+    starts.push_back({ door_at_[index(from)], 0 });
+  } else {
+    reach_doors(from, starts);
+  }
+  if (door_at_[index(to)] >= 0) {
+    goals.push_back({ door_at_[index(to)], 0 });
+  } else {
+    reach_doors(to, goals);
+  }
+
+  // Node doors_.size() stands in for the destination.
+  const int goal = doors_.size();
+  std::vector<int> cost(goal + 1, -1), parent(goal + 1, -1), exit(goal, -1);
+  std::vector<bool> done(goal + 1, false);
+  for (const auto& g : goals) exit[g.to] = g.cost;
+
+  auto estimate = [&](int node) {
+    return node == goal ? 0 : distance(doors_[node].pos, to);
+  };
+
+  auto relax = [&](int node, int c, int from_node) {
+    if (node != goal && !unlock && doors_[node].locked && node != door_at_[index(from)]) return;
+    if (cost[node] >= 0 && cost[node] <= c) return;
+    cost[node] = c;
+    parent[node] = from_node;
+    heap_.push_back({ node, c + estimate(node) });
+    std::push_heap(heap_.begin(), heap_.end());
+  };
+
+  heap_.clear();
+  for (const auto& s : starts) relax(s.to, s.cost, -1);
+
+  while (!heap_.empty()) {
+    std::pop_heap(heap_.begin(), heap_.end());
+    const int node = heap_.back().index;
+    heap_.pop_back();
+
+    if (done[node]) continue;
+    done[node] = true;
+    if (node == goal) break;
+
+    if (exit[node] >= 0) relax(goal, cost[node] + exit[node], node);
+    for (const auto& e : doors_[node].edges) relax(e.to, cost[node] + e.cost, node);
+  }
+
+  if (!done[goal]) return false;
+
+  waypoints.push_back(to);
+  for (int node = parent[goal]; node >= 0; node = parent[node]) {
+    waypoints.push_back(doors_[node].pos);
+  }
+  std::reverse(waypoints.begin(), waypoints.end());
+
+  return true;
+}
+
+// A* over jump points, appending every cell of the result to path.  The goal
+// may be a door, every other cell on the way has to be open.
+bool Pathfinder::jump_search(Position from, Position to, std::vector<Position>& path) {
+  if (from.x == to.x && from.y == to.y) return true;
+
+  ++generation_;
+  heap_.clear();
+  push(index(from), 0, -1, distance(from, to));
+
+  while (!heap_.empty()) {
+    std::pop_heap(heap_.begin(), heap_.end());
+    const Node node = heap_.back();
+    heap_.pop_back();
+
+    const int c = node.index;
+    const Position p = { c % width_, c / width_ };
+    if (node.estimate != cost_[c] + distance(p, to)) continue;
+
+    if (p.x == to.x && p.y == to.y) {
+      std::vector<int> points;
+      for (int i = c; i >= 0; i = parent_[i]) points.push_back(i);
+
+      for (size_t i = points.size() - 1; i > 0; --i) {
+        Position a = { points[i] % width_, points[i] / width_ };
+        const Position b = { points[i - 1] % width_, points[i - 1] / width_ };
+        const int dx = sign(b.x - a.x), dy = sign(b.y - a.y);
+        while (a.x != b.x || a.y != b.y) {
+          a.x += dx;
+          a.y += dy;
+          path.push_back(a);
+        }
+      }
+
+      return true;
+    }
+
+    Position dirs[4];
+    int count = 0;
+
+    const int parent = parent_[c];
+    const int dx = parent < 0 ? 0 : sign(p.x - parent % width_);
+    const int dy = parent < 0 ? 0 : sign(p.y - parent / width_);
+
+    if (parent < 0) {
+      dirs[count++] = { 0, -1 };
+      dirs[count++] = { 1, 0 };
+      dirs[count++] = { 0, 1 };
+      dirs[count++] = { -1, 0 };
+    } else if (dy != 0) {
+      // Vertical runs can turn either way.
+      dirs[count++] = { 0, dy };
+      dirs[count++] = { 1, 0 };
+      dirs[count++] = { -1, 0 };
+    } else {
+      // Horizontal runs only turn where a wall behind them stopped a
+      // vertical run from getting here first.
+      dirs[count++] = { dx, 0 };
+      if (passable(p.x, p.y - 1, to) && !passable(p.x - dx, p.y - 1, to)) dirs[count++] = { 0, -1 };
+      if (passable(p.x, p.y + 1, to) && !passable(p.x - dx, p.y + 1, to)) dirs[count++] = { 0, 1 };
+    }
+
+    for (int d = 0; d < count; ++d) {
+      int x = p.x, y = p.y;
+      if (!jump(x, y, dirs[d].x, dirs[d].y, to)) continue;
+
+      const int i = index({x, y});
+      const int g = cost_[c] + distance(p, {x, y});
+      if (stamp_[i] == generation_ && cost_[i] <= g) continue;
+      push(i, g, c, g + distance({x, y}, to));
+    }
+  }
+
+  return false;
+}
+
+// Runs from x, y in one direction until there is a reason to stop: the goal,
+// a wall, or a place where the path could need to turn.
+bool Pathfinder::jump(int& x, int& y, int dx, int dy, Position goal) const {
+  while (true) {
+    x += dx;
+    y += dy;
+
+    if (!passable(x, y, goal)) return false;
+    if (x == goal.x && y == goal.y) return true;
+
+    if (dx != 0) {
+      if (passable(x, y - 1, goal) && !passable(x - dx, y - 1, goal)) return true;
+      if (passable(x, y + 1, goal) && !passable(x - dx, y + 1, goal)) return true;
+    } else {
+      int hx = x, hy = y;
+      if (jump(hx, hy, 1, 0, goal)) return true;
+      hx = x;
+      hy = y;
+      if (jump(hx, hy, -1, 0, goal)) return true;
+    }
+  }
+}
+
+void Pathfinder::push(int index, int cost, int parent, int estimate) {
+  stamp_[index] = generation_;
+  cost_[index] = cost;
+  parent_[index] = parent;
+  heap_.push_back({ index, estimate });
+  std::push_heap(heap_.begin(), heap_.end());
+}
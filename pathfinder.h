@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Shortest paths over a four connected grid.  Open cells are grouped into
+// areas that only meet at doors, so a long query is first planned over the
+// graph of doors and each leg is then filled in with jump point search, which
+// skips along runs of open cells instead of queueing every one of them.
+// Locked doors are only gone through when the query says they can be.
+class Pathfinder {
+  public:
+
+    enum class Cell : uint8_t { Blocked, Open, Door, Locked };
+
+    struct Position {
+      int x, y;
+    };
+
+    Pathfinder(int width, int height);
+
+    void set(int x, int y, Cell cell);
+
+    // Every cell after from up to and including to, or nothing if there is no
+    // way through.
+    std::vector<Position> find_path(Position from, Position to, bool unlock);
+
+  private:
+
+    struct Edge {
+      int to, cost;
+    };
+
+    struct Door {
+      Position pos;
+      bool locked;
+      std::vector<Edge> edges;
+    };
+
+    struct Node {
+      int index, estimate;
+      bool operator<(const Node& other) const { return estimate > other.estimate; }
+    };
+
+    int width_, height_;
+    std::vector<Cell> cells_;
+    bool dirty_;
+
+    std::vector<int> areas_, door_at_;
+    std::vector<Door> doors_;
+
+    // Scratch space for searches, only valid where stamped with the current
+    // generation so nothing has to be cleared between queries.
+    std::vector<int> cost_, parent_;
+    std::vector<unsigned int> stamp_;
+    std::vector<int> queue_;
+    std::vector<Node> heap_;
+    unsigned int generation_;
+
+    Cell at(Position p) const;
+    bool passable(int x, int y, Position goal) const;
+    int index(Position p) const;
+
+    void build();
+    void reach_doors(Position from, std::vector<Edge>& edges);
+    bool plan(Position from, Position to, bool unlock, std::vector<Position>& waypoints);
+
+    bool jump_search(Position from, Position to, std::vector<Position>& path);
+    bool jump(int& x, int& y, int dx, int dy, Position goal) const;
+    void push(int index, int cost, int parent, int estimate);
+};
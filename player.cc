@@ -1,13 +1,15 @@
 #include "player.h"
 
+#include <algorithm>
+
+#include "assets.h"
+#include "dungeon.h"
 #include "powerup.h"
 
 Player::Player(int x, int y) :
-  Entity("player.png", 4, x, y, 12),
-  weapons_("weapons.png", 2, kTileSize, kTileSize),
-  ui_("ui.png", 3, kTileSize, kTileSize),
-  text_("text.png"),
-  attack_cooldown_(0),
+  Entity(Assets::sprites(Assets::Sheet::Player), x, y, 12),
+  weapons_(Assets::sprites(Assets::Sheet::Weapons)),
+  attack_cooldown_(0), throw_cooldown_(0),
   gold_(0), keys_(0) {}
 
 void Player::move(Player::Direction direction) {
@@ -69,9 +71,20 @@ void Player::attack() {
   state_transition(State::Attacking);
 }
 
+// Thrown from the middle of the player's body, the way they are facing.
+void Player::throw_dagger(Dungeon& dungeon) {
+  if (state_ == State::Attacking) return;
+  if (state_ == State::Dying) return;
+  if (throw_cooldown_ > 0) return;
+
+  if (dungeon.launch(Projectiles::Kind::Dagger, x_, y_ + kHalfTile / 2, facing_)) {
+    throw_cooldown_ = kThrowCooldown;
+  }
+}
+
 // Helper to lock walking to half-tile grid
-std::pair<double, double> grid_walk(double delta, double minor, int grid) {
-  const double dmin = minor - 8 * (int)(minor / 8);
+std::pair<Fixed, Fixed> grid_walk(Fixed delta, Fixed minor, int grid) {
+  const Fixed dmin = minor - 8 * (minor.to_int() / 8);
   if (dmin > grid) {
     if (delta > 8 - dmin) {
       return { delta - 8 + dmin, 8 - dmin };
@@ -95,6 +108,14 @@ void Player::add_key() {
   ++keys_;
 }
 
+int Player::gold() const {
+  return gold_;
+}
+
+int Player::keys() const {
+  return keys_;
+}
+
 void Player::hit(Entity& source) {
   auto powerup = dynamic_cast<Powerup*>(&source);
   if (powerup) {
@@ -108,24 +129,25 @@ void Player::update(Dungeon& dungeon, unsigned int elapsed) {
   Entity::update_generic(dungeon, elapsed);
 
   if (attack_cooldown_ > 0) attack_cooldown_ -= elapsed;
+  if (throw_cooldown_ > 0) throw_cooldown_ -= elapsed;
 
   if (state_ == State::Walking && kbtimer_ == 0) {
-    const double delta = kSpeed * elapsed;
-    std::pair<double, double> d;
-    double dx = 0, dy = 0;
+    const Fixed delta = kSpeed * elapsed;
+    std::pair<Fixed, Fixed> d;
+    Fixed dx = 0, dy = 0;
 
     switch (facing_) {
       case Direction::North:
       case Direction::South:
         d = grid_walk(delta, x_, kHalfTile / 2);
         dx = d.second;
-        dy = d.first * (facing_ == Direction::North ? -1 : 1);
+        dy = facing_ == Direction::North ? -d.first : d.first;
         break;
 
       case Direction::West:
       case Direction::East:
         d = grid_walk(delta, y_, kHalfTile / 2);
-        dx = d.first * (facing_ == Direction::West ? -1 : 1);
+        dx = facing_ == Direction::West ? -d.first : d.first;
         dy = d.second;
         break;
     }
@@ -147,39 +169,22 @@ void Player::update(Dungeon& dungeon, unsigned int elapsed) {
   }
 }
 
-void Player::draw(Graphics& graphics, int xo, int yo) const {
+void Player::draw(DrawList& list, int xo, int yo) const {
   if (iframes_ > 0 && (iframes_ / 32) % 2 == 0) return;
 
-  const int x = (int)x_ - kHalfTile - xo;
-  const int y = (int)y_ - kHalfTile - yo;
+  const int x = x_.to_int() - kHalfTile - xo;
+  const int y = y_.to_int() - kHalfTile - yo;
 
-  if (facing_ == Direction::North) draw_weapon(graphics, xo, yo);
-  sprites_.draw_ex(graphics, sprite_number(), x, y, facing_ == Direction::West, 0, 0, 0);
-  if (facing_ != Direction::North) draw_weapon(graphics, xo, yo);
+  const bool behind = facing_ == Direction::North;
+  draw_weapon(list, behind ? DrawList::Layer::Behind : DrawList::Layer::Front, xo, yo);
+  list.sprite(DrawList::Layer::Player, sprites_, sprite_number(), x, y, facing_ == Direction::West);
 
 #ifndef NDEBUG
-  hit_box().draw(graphics, 0xff0000ff, false, xo, yo);
+  hit_box().draw(list, DrawList::Layer::Front, 0xff0000ff, false, xo, yo);
 #endif
 
 }
 
-void Player::draw_hud(Graphics& graphics, int xo, int yo) const {
-  const int hearts = maxhp_ / 4;
-
-  for (int h = 0; h < hearts; ++h) {
-    const int hx = graphics.width() - kTileSize * (8 - h % 8);
-    const int hy = kTileSize * (h / 8);
-    const int n = (curhp_ > (h + 1) * 4) ? 4 : (curhp_ < h * 4) ? 0 : curhp_ - h * 4;
-    ui_.draw(graphics, n, hx, hy);
-  }
-
-  ui_.draw(graphics, 5, xo + kHalfTile, yo);
-  text_.draw(graphics, std::to_string(gold_), xo + 3 * kTileSize, yo, Text::Alignment::Right);
-
-  ui_.draw(graphics, 9, xo + kHalfTile, yo + kTileSize);
-  text_.draw(graphics, std::to_string(keys_), xo + 3 * kTileSize, yo + kTileSize, Text::Alignment::Right);
-}
-
 int Player::sprite_number() const {
   int d = 0;
 
@@ -197,22 +202,26 @@ int Player::sprite_number() const {
 }
 
 Rect Player::collision_box() const {
-  return { x_ - kHalfTile, y_, x_ + kHalfTile - 1, y_ + kHalfTile - 1};
+  const int x = x_.to_int();
+  const int y = y_.to_int();
+  return { x - kHalfTile, y, x + kHalfTile - 1, y + kHalfTile - 1};
 }
 
 Rect Player::hit_box() const {
-  return { x_ - kHalfTile + 2, y_ + 2, x_ + kHalfTile - 2, y_ + kHalfTile - 2 };
+  const int x = x_.to_int();
+  const int y = y_.to_int();
+  return { x - kHalfTile + 2, y + 2, x + kHalfTile - 2, y + kHalfTile - 2 };
 }
 
 Rect Player::attack_box() const {
   if (state_ == State::Attacking) {
-    double sx = x_;
-    double sy = y_;
-    double w = kTileSize;
-    double h = kTileSize;
+    int sx = x_.to_int();
+    int sy = y_.to_int();
+    int w = kTileSize;
+    int h = kTileSize;
 
-    const double pct = timer_ / (double)kAttackTime;
-    const double offset = (pct <= 0.5 ? pct : 1 - pct ) * 2 * kTileSize;
+    const int t = std::min(timer_, kAttackTime - timer_);
+    const int offset = t * 2 * kTileSize / kAttackTime;
 
     switch (facing_) {
       case Direction::North:
@@ -243,10 +252,10 @@ Rect Player::attack_box() const {
   }
 }
 
-void Player::draw_weapon(Graphics& graphics, int xo, int yo) const {
+void Player::draw_weapon(DrawList& list, DrawList::Layer layer, int xo, int yo) const {
   const Rect weapon = attack_box();
-  int wx = (int)weapon.left - xo;
-  int wy = (int)weapon.top - yo;
+  int wx = weapon.left - xo;
+  int wy = weapon.top - yo;
 
   if (weapon.height() != 0) {
     int weapon_sprite = 0;
@@ -270,9 +279,11 @@ void Player::draw_weapon(Graphics& graphics, int xo, int yo) const {
     }
 
     // TODO better handling of weapon sprite positioning
-    weapons_.draw(graphics, weapon_sprite, wx, wy);
+    list.sprite(layer, weapons_, weapon_sprite, wx, wy);
 #ifndef NDEBUG
-    weapon.draw(graphics, 0x0000ffff, false, xo, yo);
+    weapon.draw(list, DrawList::Layer::Front, 0x0000ffff, false, xo, yo);
 #endif
   }
 }
+
+constexpr Fixed Player::kSpeed;
@@ -2,8 +2,8 @@
 
 #include "graphics.h"
 #include "spritemap.h"
-#include "text.h"
 
+#include "draw_list.h"
 #include "entity.h"
 #include "rect.h"
 
@@ -16,14 +16,16 @@ class Player : public Entity {
     void stop();
     bool interact(Dungeon& dungeon);
     void attack();
+    void throw_dagger(Dungeon& dungeon);
 
     void transact(int amount);
     void add_key();
+    int gold() const;
+    int keys() const;
 
     void hit(Entity& source) override;
     void update(Dungeon& dungeon, unsigned int elapsed) override;
-    void draw(Graphics& graphics, int xo, int yo) const override;
-    void draw_hud(Graphics& graphics, int xo, int yo) const;
+    void draw(DrawList& list, int xo, int yo) const override;
 
     Rect collision_box() const override;
     Rect hit_box() const override;
@@ -31,19 +33,19 @@ class Player : public Entity {
 
   private:
 
-    static constexpr double kSpeed = 0.1;
+    static constexpr Fixed kSpeed = Fixed::from_double(0.1);
     static constexpr int kAttackTime = 250;
     static constexpr int kAttackCooldown = 100;
+    static constexpr int kThrowCooldown = 400;
     static constexpr int kDeathTimer = 2500;
     static constexpr int kAnimationTime = 250;
     static constexpr int kSpinTime = kAnimationTime / 2;
 
-    SpriteMap weapons_, ui_;
-    Text text_;
-    int attack_cooldown_;
+    const SpriteMap& weapons_;
+    int attack_cooldown_, throw_cooldown_;
     int gold_, keys_;
 
     int sprite_number() const override;
 
-    void draw_weapon(Graphics& graphics, int xo, int yo) const;
+    void draw_weapon(DrawList& list, DrawList::Layer layer, int xo, int yo) const;
 };
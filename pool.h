@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Objects stored in fixed size blocks with a free list.  Spawning reuses the
+// slot of something that was released, and nothing moves once it has been
+// created, so handles and references stay good while the pool grows.
+template <typename T>
+class Pool {
+  public:
+
+    struct Handle {
+      uint32_t index, generation;
+    };
+
+    Pool();
+    Pool(Pool&& other) noexcept;
+    Pool& operator=(Pool&&) = delete;
+    ~Pool();
+
+    template <typename... Args> Handle spawn(Args&&... args);
+    void release(uint32_t index);
+    void release(Handle handle);
+
+    T* get(Handle handle);
+    const T* get(Handle handle) const;
+    Handle handle(uint32_t index) const;
+
+    uint32_t capacity() const;
+    uint32_t size() const;
+    bool live(uint32_t index) const;
+
+    T& operator[](uint32_t index);
+    const T& operator[](uint32_t index) const;
+
+    template <typename F> void each(F f);
+    template <typename F> void each(F f) const;
+    template <typename F> bool any(F f) const;
+
+  private:
+
+    static constexpr uint32_t kBlockSize = 64;
+
+    struct Block {
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[kBlockSize];
+    };
+
+    std::vector<std::unique_ptr<Block>> blocks_;
+    std::vector<uint32_t> generations_;
+    std::vector<bool> live_;
+    std::vector<uint32_t> free_;
+    uint32_t size_;
+
+    T* slot(uint32_t index);
+    const T* slot(uint32_t index) const;
+    void grow();
+};
+
+template <typename T>
+Pool<T>::Pool() : blocks_(), generations_(), live_(), free_(), size_(0) {}
+
+template <typename T>
+Pool<T>::Pool(Pool&& other) noexcept :
+  blocks_(std::move(other.blocks_)),
+  generations_(std::move(other.generations_)),
+  live_(std::move(other.live_)),
+  free_(std::move(other.free_)),
+  size_(other.size_)
+{
+  other.blocks_.clear();
+  other.live_.clear();
+  other.size_ = 0;
+}
+
+template <typename T>
+Pool<T>::~Pool() {
+  for (uint32_t i = 0; i < live_.size(); ++i) {
+    if (live_[i]) slot(i)->~T();
+  }
+}
+
+template <typename T>
+template <typename... Args>
+typename Pool<T>::Handle Pool<T>::spawn(Args&&... args) {
+  if (free_.empty()) grow();
+
+  const uint32_t index = free_.back();
+  free_.pop_back();
+
+  new (slot(index)) T(std::forward<Args>(args)...);
+  live_[index] = true;
+  ++size_;
+
+  return { index, generations_[index] };
+}
+
+template <typename T>
+void Pool<T>::release(uint32_t index) {
+  if (!live(index)) return;
+
+  slot(index)->~T();
+  live_[index] = false;
+  ++generations_[index];
+  free_.push_back(index);
+  --size_;
+}
+
+template <typename T>
+void Pool<T>::release(Handle handle) {
+  if (get(handle)) release(handle.index);
+}
+
+template <typename T>
+T* Pool<T>::get(Handle handle) {
+  if (!live(handle.index)) return nullptr;
+  if (generations_[handle.index] != handle.generation) return nullptr;
+  return slot(handle.index);
+}
+
+template <typename T>
+const T* Pool<T>::get(Handle handle) const {
+  if (!live(handle.index)) return nullptr;
+  if (generations_[handle.index] != handle.generation) return nullptr;
+  return slot(handle.index);
+}
+
+template <typename T>
+typename Pool<T>::Handle Pool<T>::handle(uint32_t index) const {
+  return { index, generations_[index] };
+}
+
+template <typename T>
+uint32_t Pool<T>::capacity() const {
+  return live_.size();
+}
+
+template <typename T>
+uint32_t Pool<T>::size() const {
+  return size_;
+}
+
+template <typename T>
+bool Pool<T>::live(uint32_t index) const {
+  return index < live_.size() && live_[index];
+}
+
+template <typename T>
+T& Pool<T>::operator[](uint32_t index) {
+  return *slot(index);
+}
+
+template <typename T>
+const T& Pool<T>::operator[](uint32_t index) const {
+  return *slot(index);
+}
+
+// Objects spawned from inside f may or may not be visited by the same call.
+template <typename T>
+template <typename F>
+void Pool<T>::each(F f) {
+  for (uint32_t i = 0; i < live_.size(); ++i) {
+    if (live_[i]) f(*slot(i));
+  }
+}
+
+template <typename T>
+template <typename F>
+void Pool<T>::each(F f) const {
+  for (uint32_t i = 0; i < live_.size(); ++i) {
+    if (live_[i]) f(*slot(i));
+  }
+}
+
+template <typename T>
+template <typename F>
+bool Pool<T>::any(F f) const {
+  for (uint32_t i = 0; i < live_.size(); ++i) {
+    if (live_[i] && f(*slot(i))) return true;
+  }
+  return false;
+}
+
+template <typename T>
+T* Pool<T>::slot(uint32_t index) {
+  return reinterpret_cast<T*>(&blocks_[index / kBlockSize]->slots[index % kBlockSize]);
+}
+
+template <typename T>
+const T* Pool<T>::slot(uint32_t index) const {
+  return reinterpret_cast<const T*>(&blocks_[index / kBlockSize]->slots[index % kBlockSize]);
+}
+
+template <typename T>
+void Pool<T>::grow() {
+  const uint32_t start = live_.size();
+  blocks_.emplace_back(new Block);
+  generations_.resize(start + kBlockSize, 0);
+  live_.resize(start + kBlockSize, false);
+
+  // Reserve enough that releasing never has to allocate.
+  free_.reserve(start + kBlockSize);
+  for (uint32_t i = start + kBlockSize; i > start; --i) free_.push_back(i - 1);
+}
@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <vector>
+
+#include "pool.h"
+
+// Checks that released slots are reused with a new generation, that stale
+// handles stop working, and that everything spawned gets destroyed once.
+
+namespace {
+  int failures = 0;
+
+  void expect(bool ok, const char* what) {
+    if (!ok) {
+      std::fprintf(stderr, "FAILED: %s\n", what);
+      ++failures;
+    }
+  }
+
+  int alive = 0;
+
+  struct Counted {
+    int value;
+
+    explicit Counted(int v) : value(v) { ++alive; }
+    ~Counted() { --alive; }
+  };
+
+  void test_reuse() {
+    Pool<Counted> pool;
+
+    const auto a = pool.spawn(1);
+    const auto b = pool.spawn(2);
+    expect(pool.size() == 2, "two spawned");
+    expect(pool.get(a) && pool.get(a)->value == 1, "first handle good");
+    expect(pool.get(b) && pool.get(b)->value == 2, "second handle good");
+
+    pool.release(a);
+    expect(pool.size() == 1, "one left after release");
+    expect(!pool.live(a.index), "released slot not live");
+    expect(pool.get(a) == nullptr, "released handle stale");
+    expect(alive == 1, "released object destroyed");
+
+    const auto c = pool.spawn(3);
+    expect(c.index == a.index, "released slot reused");
+    expect(c.generation != a.generation, "reused slot has a new generation");
+    expect(pool.get(a) == nullptr, "old handle stays stale after reuse");
+    expect(pool.get(c) && pool.get(c)->value == 3, "new handle good");
+    expect(pool.handle(c.index).generation == c.generation, "handle from index matches");
+
+    // Releasing through a stale handle must not take out the new object.
+    pool.release(a);
+    expect(pool.get(c) != nullptr, "stale release ignored");
+    expect(pool.size() == 2, "size unchanged by stale release");
+  }
+
+  void test_growth() {
+    constexpr int kCount = 200;
+
+    Pool<Counted> pool;
+    std::vector<Pool<Counted>::Handle> handles;
+    std::vector<const Counted*> addresses;
+    for (int i = 0; i < kCount; ++i) {
+      handles.push_back(pool.spawn(i));
+      addresses.push_back(pool.get(handles.back()));
+    }
+    expect(pool.size() == kCount, "all spawned");
+
+    bool stable = true;
+    for (int i = 0; i < kCount; ++i) {
+      stable = stable && pool.get(handles[i]) == addresses[i] && addresses[i]->value == i;
+    }
+    expect(stable, "objects stay put while the pool grows");
+
+    for (int i = 0; i < kCount; i += 2) pool.release(handles[i]);
+    int seen = 0, sum = 0;
+    pool.each([&seen, &sum](const Counted& c) { ++seen; sum += c.value; });
+    expect(seen == kCount / 2, "each visits only live objects");
+    expect(sum == (kCount / 2) * (kCount / 2), "each visits the right objects");
+    expect(pool.any([](const Counted& c) { return c.value == 1; }), "any finds a live object");
+    expect(!pool.any([](const Counted& c) { return c.value == 0; }), "any skips released objects");
+
+    const uint32_t capacity = pool.capacity();
+    for (int i = 0; i < kCount / 2; ++i) pool.spawn(i);
+    expect(pool.capacity() == capacity, "free slots used before growing");
+  }
+}
+
+int main() {
+  test_reuse();
+  expect(alive == 0, "pool destroys what is left");
+  test_growth();
+  expect(alive == 0, "grown pool destroys what is left");
+
+  if (failures == 0) std::printf("PASSED\n");
+  return failures == 0 ? 0 : 1;
+}
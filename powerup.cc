@@ -1,7 +1,9 @@
 #include "powerup.h"
 
-Powerup::Powerup(double x, double y, Type type, int cost) :
-  Entity("ui.png", 3, x, y, 1),
+#include "assets.h"
+
+Powerup::Powerup(Fixed x, Fixed y, Type type, int cost) :
+  Entity(Assets::sprites(Assets::Sheet::Ui), x, y, 1),
   type_(type), cost_(cost) {}
 
 void Powerup::hit(Entity& source) {
@@ -31,6 +33,12 @@ void Powerup::apply(Player& target) {
   dead_ = true;
 }
 
+int Powerup::sleep_time(const Entity& player) const {
+  // Fairies are animated and need their timer to keep running.
+  if (type_ == Type::Fairy) return 0;
+  return time_to_reach(player, kContactRange);
+}
+
 int Powerup::sprite_number() const {
   switch (type_) {
     case Type::Heart: return 4;
@@ -3,15 +3,16 @@
 #include "entity.h"
 #include "player.h"
 
-class Powerup : public Entity {
+class Powerup final : public Entity {
   public:
 
     enum class Type { Heart, Fairy, Coin, Key };
 
-    Powerup(double x, double y, Type type, int cost);
+    Powerup(Fixed x, Fixed y, Type type, int cost);
 
     void hit(Entity& source);
     void apply(Player& target);
+    int sleep_time(const Entity& player) const override;
 
   private:
 
@@ -0,0 +1,162 @@
+#include "projectiles.h"
+
+#include <algorithm>
+
+#include "assets.h"
+#include "dungeon.h"
+
+// In the same order as Kind.
+const Projectiles::Style Projectiles::kStyles[] = {
+  { Fixed::kOne / 5, 480, 4 },  // Dagger
+};
+
+Projectiles::Projectiles() :
+  count_(0), edges_(), sprites_(Assets::sprites(Assets::Sheet::Weapons))
+{
+  edges_.reserve(kCapacity);
+}
+
+bool Projectiles::launch(Kind kind, Fixed x, Fixed y, Entity::Direction direction) {
+  if (count_ == kCapacity) return false;
+
+  const size_t i = count_++;
+  const Style& style = kStyles[static_cast<int>(kind)];
+
+  x_[i] = x.raw();
+  y_[i] = y.raw();
+  dx_[i] = step_x(direction);
+  dy_[i] = step_y(direction);
+  life_[i] = style.life;
+  kind_[i] = kind;
+  facing_[i] = direction;
+
+  return true;
+}
+
+void Projectiles::update(const Dungeon& dungeon, Particles& particles, unsigned int elapsed) {
+  size_t i = 0;
+  while (i < count_) {
+    life_[i] -= static_cast<int32_t>(elapsed);
+    if (life_[i] <= 0) {
+      remove(i);
+      continue;
+    }
+
+    const int32_t step = kStyles[static_cast<int>(kind_[i])].speed * (int32_t)elapsed;
+    const int32_t x = x_[i] + dx_[i] * step;
+    const int32_t y = y_[i] + dy_[i] * step;
+    const int mx = (x >> Fixed::kShift) - (x_[i] >> Fixed::kShift);
+    const int my = (y >> Fixed::kShift) - (y_[i] >> Fixed::kShift);
+
+    const auto moved = dungeon.sweep(box(i), mx, my);
+    if (moved.x != mx || moved.y != my) {
+      x_[i] += moved.x * Fixed::kOne;
+      y_[i] += moved.y * Fixed::kOne;
+      particles.emit(Particles::Effect::Sparks, Fixed::from_raw(x_[i]), Fixed::from_raw(y_[i]));
+      remove(i);
+      continue;
+    }
+
+    x_[i] = x;
+    y_[i] = y;
+    ++i;
+  }
+
+  edges_.clear();
+  for (size_t p = 0; p < count_; ++p) {
+    edges_.push_back({ box(p).left, static_cast<uint16_t>(p) });
+  }
+  std::sort(edges_.begin(), edges_.end());
+}
+
+void Projectiles::draw(DrawList& list, int xo, int yo) const {
+  for (size_t i = 0; i < count_; ++i) {
+    if (life_[i] <= 0) continue;
+
+    const int x = (x_[i] >> Fixed::kShift) - xo - 8;
+    const int y = (y_[i] >> Fixed::kShift) - yo - 8;
+    int n = kStyles[static_cast<int>(kind_[i])].sprite;
+    switch (facing_[i]) {
+      case Entity::Direction::North: n += 0; break;
+      case Entity::Direction::South: n += 1; break;
+      case Entity::Direction::West: n += 2; break;
+      case Entity::Direction::East: n += 3; break;
+    }
+    list.sprite(DrawList::Layer::Entities, sprites_, n, x, y);
+  }
+}
+
+int Projectiles::hit(const Rect& box) const {
+  // Every projectile box is the same size, so only the ones whose left edge
+  // is within one box width of this one can overlap it.
+  auto e = std::lower_bound(edges_.begin(), edges_.end(), Edge{ box.left - 2 * kHalfSize, 0 });
+  for (; e != edges_.end() && e->left <= box.right; ++e) {
+    if (life_[e->index] > 0 && this->box(e->index).intersect(box)) return e->index;
+  }
+  return -1;
+}
+
+// Spent projectiles stop hitting and drawing right away and are cleared out
+// on the next update, which keeps the sorted edges valid until then.
+void Projectiles::spend(int i) {
+  life_[i] = 0;
+}
+
+Rect Projectiles::reach(Kind kind, Fixed x, Fixed y, Entity::Direction direction) {
+  return path(kind, x.raw(), y.raw(), step_x(direction), step_y(direction), kStyles[static_cast<int>(kind)].life);
+}
+
+bool Projectiles::crosses(const Rect& box) const {
+  for (size_t i = 0; i < count_; ++i) {
+    if (life_[i] > 0 && path(kind_[i], x_[i], y_[i], dx_[i], dy_[i], life_[i]).intersect(box)) return true;
+  }
+  return false;
+}
+
+size_t Projectiles::size() const {
+  return count_;
+}
+
+Rect Projectiles::path(Kind kind, int32_t x, int32_t y, int dx, int dy, int life) {
+  const int distance = (kStyles[static_cast<int>(kind)].speed * life) >> Fixed::kShift;
+  const int px = x >> Fixed::kShift;
+  const int py = y >> Fixed::kShift;
+  const int ex = px + dx * distance;
+  const int ey = py + dy * distance;
+  return Rect(std::min(px, ex) - kHalfSize, std::min(py, ey) - kHalfSize,
+      std::max(px, ex) + kHalfSize, std::max(py, ey) + kHalfSize);
+}
+
+int Projectiles::step_x(Entity::Direction direction) {
+  switch (direction) {
+    case Entity::Direction::East: return 1;
+    case Entity::Direction::West: return -1;
+    default: return 0;
+  }
+}
+
+int Projectiles::step_y(Entity::Direction direction) {
+  switch (direction) {
+    case Entity::Direction::South: return 1;
+    case Entity::Direction::North: return -1;
+    default: return 0;
+  }
+}
+
+Rect Projectiles::box(size_t i) const {
+  const int x = x_[i] >> Fixed::kShift;
+  const int y = y_[i] >> Fixed::kShift;
+  return Rect(x - kHalfSize, y - kHalfSize, x + kHalfSize, y + kHalfSize);
+}
+
+// The last projectile takes the place of the one removed.
+void Projectiles::remove(size_t i) {
+  const size_t last = --count_;
+  x_[i] = x_[last];
+  y_[i] = y_[last];
+  dx_[i] = dx_[last];
+  dy_[i] = dy_[last];
+  life_[i] = life_[last];
+  kind_[i] = kind_[last];
+  facing_[i] = facing_[last];
+}
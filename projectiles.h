@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "spritemap.h"
+
+#include "draw_list.h"
+#include "entity.h"
+#include "fixed.h"
+#include "particles.h"
+#include "rect.h"
+
+class Dungeon;
+
+// Things in flight, kept in parallel arrays of a fixed size instead of as
+// entities.  Each step they are swept against the tiles so nothing fast can
+// skip through a wall, and hit tests first narrow the search down to the
+// projectiles near a box by keeping them sorted by their left edge.
+class Projectiles {
+  public:
+
+    enum class Kind : uint8_t { Dagger };
+
+    static constexpr size_t kCapacity = 256;
+
+    Projectiles();
+
+    bool launch(Kind kind, Fixed x, Fixed y, Entity::Direction direction);
+    void update(const Dungeon& dungeon, Particles& particles, unsigned int elapsed);
+    void draw(DrawList& list, int xo, int yo) const;
+
+    // The first projectile still flying that overlaps the box, or -1.  Only
+    // valid between update and the next launch.
+    int hit(const Rect& box) const;
+    void spend(int i);
+
+    // Everywhere a projectile launched like this could get to before it
+    // runs out, and whether any still flying could get to the box.
+    static Rect reach(Kind kind, Fixed x, Fixed y, Entity::Direction direction);
+    bool crosses(const Rect& box) const;
+
+    size_t size() const;
+
+  private:
+
+    static constexpr int kHalfSize = 3;
+
+    // Speed in raw Fixed units per millisecond.  Nothing flies out of the
+    // zones that tick every step around the player, though anything asleep
+    // in the way still has to be woken.
+    struct Style {
+      int32_t speed;
+      int life;
+      int sprite;
+    };
+
+    static const Style kStyles[];
+
+    struct Edge {
+      int left;
+      uint16_t index;
+      bool operator<(const Edge& other) const { return left < other.left; }
+    };
+
+    size_t count_;
+    int32_t x_[kCapacity], y_[kCapacity];
+    int8_t dx_[kCapacity], dy_[kCapacity];
+    int32_t life_[kCapacity];
+    Kind kind_[kCapacity];
+    Entity::Direction facing_[kCapacity];
+    std::vector<Edge> edges_;
+
+    const SpriteMap& sprites_;
+
+    static Rect path(Kind kind, int32_t x, int32_t y, int dx, int dy, int life);
+    static int step_x(Entity::Direction direction);
+    static int step_y(Entity::Direction direction);
+
+    Rect box(size_t i) const;
+    void remove(size_t i);
+};
@@ -0,0 +1,49 @@
+#include "random.h"
+
+Random::Random(uint64_t seed, uint64_t stream) : state_(0), increment_((stream << 1) | 1) {
+  next();
+  state_ += seed;
+  next();
+}
+
+uint64_t Random::derive(uint64_t seed, uint64_t stream) {
+  // splitmix64 finalizer
+  uint64_t z = seed + (stream + 1) * 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+uint32_t Random::next() {
+  const uint64_t old = state_;
+  state_ = old * 6364136223846793005ull + increment_;
+
+  const uint32_t shifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+  const uint32_t rotation = static_cast<uint32_t>(old >> 59);
+  return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+}
+
+// Uniform over [min, max] without modulo bias, using Lemire's multiply and
+// reject.
+int Random::range(int min, int max) {
+  const uint32_t span = static_cast<uint32_t>(max - min) + 1;
+  if (span == 0) return static_cast<int>(next());
+
+  uint64_t m = static_cast<uint64_t>(next()) * span;
+  uint32_t low = static_cast<uint32_t>(m);
+
+  if (low < span) {
+    const uint32_t threshold = (0u - span) % span;
+    while (low < threshold) {
+      m = static_cast<uint64_t>(next()) * span;
+      low = static_cast<uint32_t>(m);
+    }
+  }
+
+  return static_cast<int>(static_cast<uint32_t>(min) + static_cast<uint32_t>(m >> 32));
+}
+
+// Uniform over [0, 1).
+double Random::real() {
+  return next() / 4294967296.0;
+}
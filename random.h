@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Small PCG generator.  Every stream from the same seed is independent, and
+// the numbers and ranges come out the same with any compiler or standard
+// library, so a run can be replayed from its seed.
+class Random {
+  public:
+
+    Random(uint64_t seed, uint64_t stream);
+
+    // Mixes a stream number into a seed, for handing seeds down.
+    static uint64_t derive(uint64_t seed, uint64_t stream);
+
+    uint32_t next();
+    int range(int min, int max);
+    double real();
+
+  private:
+
+    uint64_t state_, increment_;
+};
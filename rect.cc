@@ -1,30 +1,23 @@
 #include "rect.h"
 
-Rect::Rect(double left, double top, double right, double bottom) :
+Rect::Rect(int left, int top, int right, int bottom) :
   left(left), top(top), right(right), bottom(bottom) {}
 
 bool Rect::empty() const {
   return right == left || top == bottom;
 }
 
-double Rect::width() const {
+int Rect::width() const {
   return right - left;
 }
 
-double Rect::height() const {
+int Rect::height() const {
   return bottom - top;
 }
 
-void Rect::draw(Graphics& graphics, int color, bool filled, int xo, int yo) const {
+void Rect::draw(DrawList& list, DrawList::Layer layer, int color, bool filled, int xo, int yo) const {
   if (empty()) return;
-
-  const SDL_Rect r = {
-    (int)left - xo,
-    (int)top - yo,
-    (int)width(),
-    (int)height(),
-  };
-  graphics.draw_rect(&r, color, filled);
+  list.rect(layer, left - xo, top - yo, width(), height(), color, filled);
 }
 
 bool Rect::intersect(const Rect& other) const {
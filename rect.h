@@ -2,18 +2,18 @@
 
 #include <iostream>
 
-#include "graphics.h"
+#include "draw_list.h"
 
 class Rect {
   public:
-    Rect(double left, double top, double right, double bottom);
-    double left, top, right, bottom;
+    Rect(int left, int top, int right, int bottom);
+    int left, top, right, bottom;
 
     bool empty() const;
-    double width() const;
-    double height() const;
+    int width() const;
+    int height() const;
 
-    void draw(Graphics& graphics, int color, bool filled, int xo, int yo) const;
+    void draw(DrawList& list, DrawList::Layer layer, int color, bool filled, int xo, int yo) const;
 
     bool intersect(const Rect& other) const;
 };
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <SDL.h>
+
+#include "graphics.h"
+
+#include "config.h"
+#include "draw_list.h"
+#include "dungeon.h"
+#include "hud.h"
+#include "player.h"
+
+// Draws a large floor that has all been seen from a camera that sweeps back and
+// forth across it, the same way DungeonScreen draws a frame, and reports
+// how long the frames took and how many draw calls they made.  Uses SDL's
+// dummy video driver and software renderer so it runs without a display.
+//
+//   render_benchmark [--frames=N] [--entities=N] [--size=N] [--seed=N]
+
+namespace {
+  constexpr int kHudHeight = 48;
+  constexpr int kMapWidth = kHudHeight * 4/3;
+
+  struct Options {
+    int frames = 2000;
+    int entities = 500;
+    int size = 151;
+    unsigned long seed = 1;
+  };
+
+  bool flag(const char* arg, const char* name, unsigned long& value) {
+    const size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') return false;
+    value = std::strtoul(arg + length + 1, nullptr, 10);
+    return true;
+  }
+
+  Options parse(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+      unsigned long value;
+      if (flag(argv[i], "--frames", value)) {
+        options.frames = std::max(1ul, value);
+      } else if (flag(argv[i], "--entities", value)) {
+        options.entities = value;
+      } else if (flag(argv[i], "--size", value)) {
+        options.size = std::min(1023ul, std::max(31ul, value)) | 1;
+      } else if (flag(argv[i], "--seed", value)) {
+        options.seed = value;
+      } else {
+        std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+        std::exit(1);
+      }
+    }
+    return options;
+  }
+
+  // Goes from 0 up to range and back down again.
+  int sweep(int t, int range) {
+    if (range <= 0) return 0;
+    t %= 2 * range;
+    return t < range ? t : 2 * range - t;
+  }
+
+  double percentile(const std::vector<double>& sorted, int p) {
+    return sorted[(sorted.size() - 1) * p / 100];
+  }
+}
+
+int main(int argc, char** argv) {
+  const Options options = parse(argc, argv);
+
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+  SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+    std::fprintf(stderr, "Couldn't start SDL: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  {
+    Graphics graphics(kConfig.graphics);
+
+    // Far too big for the stack.
+    std::unique_ptr<Dungeon> floor(new Dungeon(options.size, options.size, Dungeon::TuningParams{1.0, 0.75, 0.02, 3}));
+    Dungeon& dungeon = *floor;
+    dungeon.generate(options.seed);
+    dungeon.add_enemies(options.entities);
+    dungeon.reveal();
+    dungeon.hide();
+
+    Player player(0, 0);
+    Hud hud;
+    DrawList list;
+
+    const int width = kConfig.graphics.width;
+    const int height = kConfig.graphics.height;
+    const int xrange = options.size * 16 - width;
+    const int yrange = options.size * 16 - height + kHudHeight;
+
+    std::vector<double> times;
+    size_t commands = 0, groups = 0;
+
+    for (int frame = 0; frame < options.frames; ++frame) {
+      const int xo = sweep(frame * 3, xrange);
+      const int yo = sweep(frame * 2, yrange) - kHudHeight;
+      player.set_position(xo + width / 2, yo + (height + kHudHeight) / 2);
+
+      const auto p = dungeon.grid_coords(player.x(), player.y());
+      dungeon.calculate_visibility(p.x, p.y);
+
+      const auto start = std::chrono::steady_clock::now();
+
+      list.begin(width, height);
+      dungeon.draw(list, kHudHeight, xo, yo, 0);
+      player.draw(list, xo, yo);
+
+      list.rect(DrawList::Layer::Hud, 0, 0, width, kHudHeight, 0x000000ff, true);
+      const Rect map_region = {
+        p.x - kMapWidth / 2,
+        p.y - kHudHeight / 2,
+        p.x + kMapWidth / 2,
+        p.y + kHudHeight / 2,
+      };
+      dungeon.draw_map(list, map_region, { 0, 0, kMapWidth, kHudHeight });
+      hud.draw(list, player, 0, kMapWidth);
+      list.sort();
+
+      graphics.clear();
+      list.draw(graphics);
+      graphics.flip();
+
+      const auto end = std::chrono::steady_clock::now();
+      times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+      commands += list.size();
+      groups += list.groups();
+    }
+
+    std::sort(times.begin(), times.end());
+    std::printf("floor %dx%d, %d entities, %d frames\n",
+        options.size, options.size, options.entities, options.frames);
+    std::printf("frame time p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        percentile(times, 50), percentile(times, 95), percentile(times, 99), times.back());
+    std::printf("draw calls %.1f per frame in %.1f groups\n",
+        commands / (double)options.frames, groups / (double)options.frames);
+  }
+
+  SDL_Quit();
+  return 0;
+}
@@ -1,15 +1,35 @@
 #include "slime.h"
 
-#include <random>
+#include <algorithm>
 
-Slime::Slime(double x, double y) : Entity("enemies.png", 8, x, y, 3) {}
+#include "assets.h"
+#include "dungeon.h"
+
+Slime::Slime(Fixed x, Fixed y) :
+  Entity(Assets::sprites(Assets::Sheet::Enemies), x, y, 3),
+  chasing_(false), tx_(0), ty_(0) {}
 
 void Slime::ai(const Dungeon& dungeon, const Entity& player) {
-  if (state_ == State::Walking && timer_ > kSwitchTime) {
+  if (state_ == State::Walking && !chasing_ && timer_ > kSwitchTime) {
     state_transition(State::Waiting);
-  } else if (state_ == State::Waiting && timer_ > kHoldTime) {
-    std::uniform_int_distribution<int> r(0, 3);
-    facing_ = static_cast<Entity::Direction>(r(rd_));
+  } else if (state_ == State::Waiting && timer_ > hold_time()) {
+    const auto p = dungeon.grid_coords(x_, y_);
+    const int distance = dungeon.player_distance(p.x, p.y);
+    const auto next = dungeon.next_step(p.x, p.y);
+
+    chasing_ = player.alive() && distance > 0 && distance <= kChaseDistance;
+    if (chasing_) {
+      if (next.y < p.y) facing_ = Direction::North;
+      else if (next.y > p.y) facing_ = Direction::South;
+      else if (next.x < p.x) facing_ = Direction::West;
+      else facing_ = Direction::East;
+
+      tx_ = next.x * kTileSize + kHalfTile;
+      ty_ = next.y * kTileSize + kHalfTile;
+    } else {
+      facing_ = static_cast<Entity::Direction>(rd_.range(0, 3));
+    }
+
     state_transition(State::Walking);
   }
 }
@@ -17,13 +37,36 @@ void Slime::ai(const Dungeon& dungeon, const Entity& player) {
 void Slime::update(Dungeon& dungeon, unsigned int elapsed) {
   Entity::update(dungeon, elapsed);
 
-  if (state_ == State::Walking) {
+  if (state_ != State::Walking) return;
+
+  if (chasing_) {
+    // Head for the centre of the next tile, straightening up first so the
+    // slime doesn't catch on corners.
+    Fixed budget = kMoveSpeed * elapsed;
+    const Fixed dx = std::max(-budget, std::min(budget, tx_ - x_));
+    budget -= dx.abs();
+    const Fixed dy = std::max(-budget, std::min(budget, ty_ - y_));
+
+    if (!move_if_possible(dungeon, dx, dy) || (x_ == tx_ && y_ == ty_)) {
+      state_transition(State::Waiting);
+    }
+  } else {
     auto delta = Entity::delta_direction(facing_, kMoveSpeed * elapsed);
     if (!move_if_possible(dungeon, delta.first, delta.second)) state_transition(State::Waiting);
   }
 }
 
+int Slime::sleep_time(const Entity& player) const {
+  if (state_ != State::Waiting || !settled()) return 0;
+  return std::min(hold_time() + 1 - timer_, time_to_reach(player, kContactRange));
+}
+
+int Slime::hold_time() const {
+  return chasing_ ? kChaseHoldTime : kHoldTime;
+}
 
 int Slime::sprite_number() const {
   return state_ == State::Walking ? (timer_ / 250) % 3 + 1 : 1;
 }
+
+constexpr Fixed Slime::kMoveSpeed;
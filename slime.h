@@ -2,19 +2,26 @@
 
 #include "entity.h"
 
-class Slime : public Entity {
+class Slime final : public Entity {
   public:
 
-    Slime(double x, double y);
+    Slime(Fixed x, Fixed y);
 
     void ai(const Dungeon& dungeon, const Entity& player) override;
     void update(Dungeon& dungeon, unsigned int elapsed) override;
+    int sleep_time(const Entity& player) const override;
 
   private:
 
-    static constexpr double kMoveSpeed = 0.02;
+    static constexpr Fixed kMoveSpeed = Fixed::from_double(0.02);
     static constexpr int kHoldTime = 750;
     static constexpr int kSwitchTime = kHoldTime * 2;
+    static constexpr int kChaseHoldTime = 250;
+    static constexpr int kChaseDistance = 8;
 
+    bool chasing_;
+    Fixed tx_, ty_;
+
+    int hold_time() const;
     int sprite_number() const override;
 };
@@ -1,36 +1,46 @@
 #include "spike_trap.h"
 
-SpikeTrap::SpikeTrap(double x, double y) : Entity("enemies.png", 8, x, y, 1) {}
+#include <algorithm>
+
+#include "assets.h"
+#include "dungeon.h"
+
+SpikeTrap::SpikeTrap(Fixed x, Fixed y) :
+  Entity(Assets::sprites(Assets::Sheet::Enemies), x, y, 1),
+  home_x_(x.to_int() / kTileSize), home_y_(y.to_int() / kTileSize),
+  west_(home_x_), east_(home_x_), north_(home_y_), south_(home_y_) {}
 
 void SpikeTrap::ai(const Dungeon& dungeon, const Entity& player) {
   if (state_ != State::Waiting) return;
   if (!player.alive()) return;
 
   const auto p = dungeon.grid_coords(player.x(), player.y());
-  const auto s = dungeon.grid_coords(x(), y());
-
-  if (p.x == s.x) {
-    const bool north = p.y < s.y;
-    const int start = north ? p.y : s.y;
-    const int end = north ? s.y : p.y;
-
-    for (int y = start + 1; y < end; ++y) {
-      if (!dungeon.walkable(p.x, y)) return;
-    }
 
-    facing_ = north ? Direction::North : Direction::South;
+  if (p.x == home_x_ && p.y >= north_ && p.y <= south_) {
+    facing_ = p.y < home_y_ ? Direction::North : Direction::South;
     state_transition(State::Attacking);
-  } else if (p.y == s.y) {
-    const bool west = p.x < s.x;
-    const int start = west ? p.x : s.x;
-    const int end = west ? s.x : p.x;
+  } else if (p.y == home_y_ && p.x >= west_ && p.x <= east_) {
+    facing_ = p.x < home_x_ ? Direction::West : Direction::East;
+    state_transition(State::Attacking);
+  }
+}
 
-    for (int x = start + 1; x < end; ++x) {
-      if (!dungeon.walkable(x, p.y)) return;
-    }
+void SpikeTrap::measure_reach(const Dungeon& dungeon) {
+  west_ = east_ = home_x_;
+  north_ = south_ = home_y_;
 
-    facing_ = west ? Direction::West : Direction::East;
-    state_transition(State::Attacking);
+  while (dungeon.walkable(west_ - 1, home_y_)) --west_;
+  while (dungeon.walkable(east_ + 1, home_y_)) ++east_;
+  while (dungeon.walkable(home_x_, north_ - 1)) --north_;
+  while (dungeon.walkable(home_x_, south_ + 1)) ++south_;
+}
+
+// Only a change inside the reach or right at either end of it can move the
+// ends.
+void SpikeTrap::tile_changed(const Dungeon& dungeon, int x, int y) {
+  if ((y == home_y_ && x >= west_ - 1 && x <= east_ + 1) ||
+      (x == home_x_ && y >= north_ - 1 && y <= south_ + 1)) {
+    measure_reach(dungeon);
   }
 }
 
@@ -46,7 +56,7 @@ void SpikeTrap::update(Dungeon& dungeon, unsigned int elapsed) {
     }
   }
 
-  double speed = state_ == State::Attacking ? kChargingSpeed : kRetreatingSpeed;
+  const Fixed speed = state_ == State::Attacking ? kChargingSpeed : kRetreatingSpeed;
   auto delta = Entity::delta_direction(facing_, speed * elapsed);
 
   if (!move_if_possible(dungeon, delta.first, delta.second)) {
@@ -58,6 +68,23 @@ void SpikeTrap::update(Dungeon& dungeon, unsigned int elapsed) {
   }
 }
 
+int SpikeTrap::sleep_time(const Entity& player) const {
+  if (!settled()) return 0;
+
+  const int contact = time_to_reach(player, kContactRange);
+
+  if (state_ == State::Waiting) {
+    // Triggering needs the player in the same row or column.
+    const int dx = (player.x() - x_).abs().to_int() - kTileSize;
+    const int dy = (player.y() - y_).abs().to_int() - kTileSize;
+    return std::min(contact, std::max(0, std::min(dx, dy) * kPixelTime));
+  } else if (state_ == State::Holding) {
+    return std::min(contact, kHoldTime + 1 - timer_);
+  }
+
+  return 0;
+}
+
 int SpikeTrap::damage() const {
   return 4;
 }
@@ -72,9 +99,8 @@ int SpikeTrap::sprite_number() const {
 
 bool SpikeTrap::collision(const Dungeon& dungeon) const {
   const auto p = dungeon.grid_coords(x_, y_);
-  return dungeon.any_entity_at(p.x, p.y,
-      [this](const std::unique_ptr<Entity>& e){
-        if (e.get() == this) return false;
-        return dynamic_cast<SpikeTrap*>(e.get()) != nullptr;
-      }) || Entity::collision(dungeon);;
+  return dungeon.spike_trap_at(p.x, p.y, this);
 }
+
+constexpr Fixed SpikeTrap::kChargingSpeed;
+constexpr Fixed SpikeTrap::kRetreatingSpeed;
@@ -2,13 +2,17 @@
 
 #include "entity.h"
 
-class SpikeTrap : public Entity {
+class SpikeTrap final : public Entity {
   public:
 
-    SpikeTrap(double x, double y);
+    SpikeTrap(Fixed x, Fixed y);
 
     void ai(const Dungeon& dungeon, const Entity& player) override;
     void update(Dungeon& dungeon, unsigned int elapsed) override;
+    int sleep_time(const Entity& player) const override;
+
+    void measure_reach(const Dungeon& dungeon);
+    void tile_changed(const Dungeon& dungeon, int x, int y);
 
     int damage() const;
 
@@ -16,10 +20,15 @@ class SpikeTrap : public Entity {
 
   private:
 
-    static constexpr double kChargingSpeed = 0.15;
-    static constexpr double kRetreatingSpeed = kChargingSpeed / 2;
+    static constexpr Fixed kChargingSpeed = Fixed::from_double(0.15);
+    static constexpr Fixed kRetreatingSpeed = kChargingSpeed / 2;
     static constexpr int kHoldTime = 500;
 
+    // The tile the trap rests on and how far the open row and column through
+    // it run, inclusive.
+    int home_x_, home_y_;
+    int west_, east_, north_, south_;
+
     int sprite_number() const override;
     bool collision(const Dungeon& dungeon) const override;
 };
@@ -0,0 +1,92 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) :
+  work_(nullptr), count_(0), grain_(1), chunks_(0), active_(0),
+  next_(0), generation_(0), stop_(false)
+{
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::run, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+size_t ThreadPool::size() const {
+  return workers_.size();
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain, const Work& work) {
+  if (count == 0) return;
+  if (workers_.empty() || count <= grain) {
+    work(0, count);
+    return;
+  }
+
+  {
+    // Stragglers from the last call may still be on their way out of drain.
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]{ return active_ == 0; });
+
+    work_ = &work;
+    count_ = count;
+    grain_ = grain;
+    chunks_ = (count + grain - 1) / grain;
+    next_ = 0;
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  drain();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this]{ return chunks_ == 0; });
+  work_ = nullptr;
+}
+
+void ThreadPool::run() {
+  unsigned int seen = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this, seen]{ return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+      ++active_;
+    }
+
+    drain();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --active_;
+    }
+    done_.notify_all();
+  }
+}
+
+void ThreadPool::drain() {
+  while (true) {
+    const size_t begin = next_.fetch_add(grain_);
+    if (begin >= count_) return;
+
+    (*work_)(begin, std::min(begin + grain_, count_));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--chunks_ == 0) done_.notify_all();
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for splitting a loop into chunks.  The thread
+// calling parallel_for works on chunks too and only returns once every chunk
+// is finished.
+class ThreadPool {
+  public:
+
+    typedef std::function<void(size_t begin, size_t end)> Work;
+
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    static ThreadPool& shared();
+
+    size_t size() const;
+    void parallel_for(size_t count, size_t grain, const Work& work);
+
+  private:
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+
+    const Work* work_;
+    size_t count_, grain_, chunks_, active_;
+    std::atomic<size_t> next_;
+    unsigned int generation_;
+    bool stop_;
+
+    void run();
+    void drain();
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Two level hashed timer wheel.  The inner wheel covers the next 64 ticks of
+// kResolution milliseconds, the outer wheel the next 64 turns of the inner
+// wheel, and anything further out is parked in the outer wheel and looked at
+// again when its slot comes around.  Items never fire early.
+template <typename T>
+class TimerWheel {
+  public:
+
+    TimerWheel();
+
+    void schedule(unsigned int when, const T& item);
+    size_t size() const;
+
+    template <typename F> void advance(unsigned int now, F fire);
+
+  private:
+
+    static constexpr unsigned int kResolution = 16;
+    static constexpr unsigned int kBits = 6;
+    static constexpr unsigned int kSlots = 1 << kBits;
+    static constexpr unsigned int kMask = kSlots - 1;
+
+    struct Entry {
+      unsigned int tick;
+      T item;
+    };
+
+    std::vector<Entry> inner_[kSlots], outer_[kSlots], firing_;
+    unsigned int current_;
+    size_t size_;
+
+    void insert(const Entry& entry);
+};
+
+template <typename T>
+TimerWheel<T>::TimerWheel() : current_(0), size_(0) {}
+
+template <typename T>
+void TimerWheel<T>::schedule(unsigned int when, const T& item) {
+  const unsigned int tick = (when + kResolution - 1) / kResolution;
+  insert({ tick > current_ ? tick : current_ + 1, item });
+  ++size_;
+}
+
+template <typename T>
+size_t TimerWheel<T>::size() const {
+  return size_;
+}
+
+template <typename T>
+template <typename F>
+void TimerWheel<T>::advance(unsigned int now, F fire) {
+  const unsigned int target = now / kResolution;
+
+  while (current_ < target) {
+    ++current_;
+
+    if ((current_ & kMask) == 0) {
+      auto& slot = outer_[(current_ >> kBits) & kMask];
+      firing_.swap(slot);
+      for (const auto& entry : firing_) insert(entry);
+      firing_.clear();
+    }
+
+    auto& slot = inner_[current_ & kMask];
+    firing_.swap(slot);
+    for (const auto& entry : firing_) {
+      if (entry.tick > current_) {
+        insert(entry);
+      } else {
+        --size_;
+        fire(entry.item);
+      }
+    }
+    firing_.clear();
+  }
+}
+
+template <typename T>
+void TimerWheel<T>::insert(const Entry& entry) {
+  const unsigned int delta = entry.tick - current_;
+  if (delta < kSlots) {
+    inner_[entry.tick & kMask].push_back(entry);
+  } else {
+    const unsigned int tick = delta < kSlots * kSlots ? entry.tick : current_ + kSlots * kSlots - 1;
+    outer_[(tick >> kBits) & kMask].push_back(entry);
+  }
+}
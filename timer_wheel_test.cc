@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <vector>
+
+#include "timer_wheel.h"
+
+// Checks that items fire once, never early and not long after they are due,
+// including ones far enough out to start in the outer wheel or be parked.
+
+namespace {
+  int failures = 0;
+
+  void expect(bool ok, const char* what) {
+    if (!ok) {
+      std::fprintf(stderr, "FAILED: %s\n", what);
+      ++failures;
+    }
+  }
+
+  struct Timer {
+    unsigned int when;
+    int index;
+  };
+
+  void test_cascade() {
+    // Within the inner wheel, a few turns of it, and past the outer wheel.
+    const std::vector<unsigned int> times = {
+      0, 1, 15, 16, 17, 100, 1023, 1024, 1025, 5000, 65535, 65536, 70000, 200000,
+    };
+    constexpr unsigned int kStep = 10;
+    constexpr unsigned int kEnd = 210000;
+
+    TimerWheel<Timer> wheel;
+    for (size_t i = 0; i < times.size(); ++i) wheel.schedule(times[i], { times[i], static_cast<int>(i) });
+    expect(wheel.size() == times.size(), "all scheduled");
+
+    std::vector<int> fired(times.size(), 0);
+    bool early = false, late = false;
+    for (unsigned int now = 0; now <= kEnd; now += kStep) {
+      wheel.advance(now, [&](const Timer& t) {
+          ++fired[t.index];
+          if (t.when > now) early = true;
+          if (now >= t.when + 16 + kStep) late = true;
+        });
+    }
+
+    bool once = true;
+    for (int f : fired) once = once && f == 1;
+    expect(once, "each item fired once");
+    expect(!early, "nothing fired early");
+    expect(!late, "nothing fired late");
+    expect(wheel.size() == 0, "wheel empty");
+  }
+
+  // Items scheduled from inside the callback and in one big jump.
+  void test_reschedule() {
+    TimerWheel<int> wheel;
+    wheel.schedule(50, 3);
+
+    int count = 0;
+    unsigned int last = 0;
+    for (unsigned int now = 0; now <= 10000; now += 16) {
+      wheel.advance(now, [&](int left) {
+          ++count;
+          last = now;
+          if (left > 0) wheel.schedule(now + 2000, left - 1);
+        });
+    }
+    expect(count == 4, "rescheduled from the callback");
+    expect(last >= 6050, "rescheduled items wait their turn");
+
+    wheel.schedule(100000, 0);
+    int jumped = 0;
+    wheel.advance(99000, [&](int) { ++jumped; });
+    expect(jumped == 0, "not due after a long jump");
+    wheel.advance(100016, [&](int) { ++jumped; });
+    expect(jumped == 1, "due after a long jump");
+  }
+}
+
+int main() {
+  test_cascade();
+  test_reschedule();
+
+  if (failures == 0) std::printf("PASSED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -1,8 +1,9 @@
 #include "title_screen.h"
 
+#include "assets.h"
 #include "dungeon_screen.h"
 
-TitleScreen::TitleScreen() : text_("text.png"), backdrop_("title.png") {}
+TitleScreen::TitleScreen() : text_(Assets::text()), backdrop_("title.png") {}
 
 bool TitleScreen::update(const Input& input, Audio&, unsigned int elapsed) {
   timer_ = (timer_ + elapsed) % 1000;
@@ -10,6 +11,8 @@ bool TitleScreen::update(const Input& input, Audio&, unsigned int elapsed) {
 }
 
 void TitleScreen::draw(Graphics& graphics) const {
+  Assets::preload(graphics);
+
   backdrop_.draw(graphics);
   if (timer_ < 500) {
     const int x = graphics.width() / 2;
@@ -21,6 +21,6 @@ class TitleScreen : public Screen {
   private:
 
     int timer_;
-    Text text_;
+    const Text& text_;
     Backdrop backdrop_;
 };